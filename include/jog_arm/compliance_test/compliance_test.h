@@ -39,12 +39,13 @@
 #ifndef COMPLIANCE_TEST_H
 #define COMPLIANCE_TEST_H
 
-#include <geometry_msgs/TransformStamped.h>
+#include <atomic>
 #include <geometry_msgs/TwistStamped.h>
 #include <geometry_msgs/WrenchStamped.h>
 #include <jog_arm/compliant_control/compliant_control.h>
+#include <jog_arm/compliant_control/wrench_transformer.h>
+#include <memory>
 #include <ros/ros.h>
-#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <tf2_ros/transform_listener.h>
 
 namespace compliance_test
@@ -58,13 +59,10 @@ private:
   // CB for halt warnings from the jog_arm nodes
   void haltCB(const std_msgs::Bool::ConstPtr& msg);
 
-  // CB for force/torque data
+  // CB for force/torque data. Runs the compliance calcs on every sample once
+  // they are started
   void ftCB(const geometry_msgs::WrenchStamped::ConstPtr& msg);
 
-  // Transform a wrench to the EE frame
-  geometry_msgs::WrenchStamped transformToEEF(const geometry_msgs::WrenchStamped wrench_in,
-                                              const std::string desired_ee_frame);
-
   ros::NodeHandle n_;
 
   ros::AsyncSpinner spinner_;
@@ -79,8 +77,26 @@ private:
   // Did one of the jog nodes halt motion?
   bool jog_is_halted_ = false;
 
+  // Set once comp_ is ready for ftCB
+  std::atomic<bool> compliance_started_{ false };
+
+  // Only used by ftCB after compliance_started_
+  std::unique_ptr<compliant_control::CompliantControl> comp_;
+  compliant_control::Vector6d vel_nom_, vel_out_;
+  geometry_msgs::TwistStamped jog_cmd_;
+  ros::Time prev_cmd_time_;
+
+  // Velocity cmds are decimated to this period [s]. The FT data is filtered at
+  // the sensor rate.
+  const double cmd_period_ = 0.01;
+
+  std::atomic<compliantEnum::exitCondition> compliance_condition_{ compliantEnum::CONDITION_NOT_MET };
+
   tf2_ros::Buffer tf_buffer_;
   tf2_ros::TransformListener tf_listener_;
+
+  // Sensor frame --> EE frame. Used by ftCB.
+  std::unique_ptr<compliant_control::WrenchTransformer> wrench_transformer_;
 };
 
 }  // end namespace compliance_test
@@ -8,10 +8,12 @@
  * wrench[i]/stiffness[i]
  */
 
+#include <Eigen/Core>
 #include <float.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TwistStamped.h>
 #include <geometry_msgs/WrenchStamped.h>
+#include <jog_arm/support/filter_bank.h>
 #include <math.h>
 #include <ros/ros.h>
 #include <std_msgs/Bool.h>
@@ -46,8 +48,21 @@ enum exitCondition
 namespace compliant_control
 {
 class CompliantControl;
-class LowPassFilter;
 
+// One entry per compliantEnum dimension: force xyz, torque xyz or linear xyz, angular xyz
+typedef Eigen::Matrix<double, compliantEnum::NUM_DIMS, 1> Vector6d;
+
+// Copy a wrench msg into force xyz, torque xyz
+Vector6d wrenchToVector(const geometry_msgs::Wrench& wrench);
+
+/**
+ * Class CompliantControl - Adjust nominal velocities by the filtered wrench.
+ *
+ * The Vector6d overloads don't allocate, so they can keep up with the native
+ * rate of a force/torque sensor. The std::vector and msg overloads copy into
+ * them. Feed every sensor sample to getFT so the filters see the whole signal,
+ * and call getVelocity(vIn, vOut) as often as cmds are needed.
+ */
 class CompliantControl
 {
 public:
@@ -56,14 +71,25 @@ public:
                    double filterParam, geometry_msgs::WrenchStamped bias, double highestAllowableForce,
                    double highestAllowableTorque);
 
+  CompliantControl(const Vector6d& stiffness, const Vector6d& deadband, const Vector6d& endConditionWrench,
+                   double filterParam, const Vector6d& bias, double highestAllowableForce,
+                   double highestAllowableTorque);
+
   // Set the "springiness" of compliance in each direction.
   void setStiffness(std::vector<double> stiffness);
+  void setStiffness(const Vector6d& stiffness);
 
   // Exit when the given force/torque wrench is achieved in any direction
   void setEndCondition(std::vector<double> endConditionWrench);
+  void setEndCondition(const Vector6d& endConditionWrench);
 
   // Update member variables with current, filtered forces/torques
   void getFT(geometry_msgs::WrenchStamped ftData);
+  void getFT(const Vector6d& ftData);
+
+  // Filter a batch of samples, oldest first, e.g. everything the sensor
+  // delivered since the last velocity cmd
+  void getFT(const Vector6d* ftData, std::size_t numSamples);
 
   // Set the "springiness" of compliance in each direction
   void adjustStiffness(compliantEnum::dimension dim, double stiffness);
@@ -73,10 +99,16 @@ public:
 
   // Bias the FT values
   void biasSensor(geometry_msgs::WrenchStamped bias);
+  void biasSensor(const Vector6d& bias);
 
   // Set the target FT wrench
   compliantEnum::exitCondition getVelocity(std::vector<double> vIn, geometry_msgs::WrenchStamped ftData,
                                            std::vector<double>& vOut);
+  compliantEnum::exitCondition getVelocity(const Vector6d& vIn, const Vector6d& ftData, Vector6d& vOut);
+
+  // From the wrench filtered by the last getFT. Lets getFT run at the sensor
+  // rate and this at the cmd rate.
+  compliantEnum::exitCondition getVelocity(const Vector6d& vIn, Vector6d& vOut);
 
   /**
    * Set the topic that force/torque data is read from.
@@ -90,35 +122,22 @@ public:
    */
   void setVelTopic(std::string velTop);
 
-  std::vector<double> stiffness_;
-  std::vector<double> deadband_;
-  std::vector<double> end_condition_wrench_;
-  std::vector<double> ft_;
-  std::vector<double> bias_;                 // Initial biased force
+  Vector6d stiffness_;
+  Vector6d deadband_;
+  Vector6d end_condition_wrench_;
+  Vector6d ft_;
+  Vector6d bias_;                            // Initial biased force
   double safeForceLimit_, safeTorqueLimit_;  // Quit if these forces/torques are exceeded
-  std::vector<compliant_control::LowPassFilter> vectorOfFilters_;
-
-private:
-};
-
-class LowPassFilter
-{
-public:
-  LowPassFilter(double filterParam);
-  double filter(const double& new_msrmt);
-
-  // Related to the cutoff frequency of the filter.
-  // filterParam=1 results in a cutoff at 1/4 of the sampling rate.
-  // See bitbucket.org/AndyZe/pid for slightly more sophistication.
+  // One channel per dimension.
   // Larger filterParam --> trust the filtered data more, trust the measurements
   // less.
-  double filterParam_ = 4.;
+  jog_arm::FilterBank filters_;
 
-  void reset(double data);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
 private:
-  std::vector<double> prev_msrmts_ = { 0., 0., 0. };
-  std::vector<double> prev_filtered_msrmts_ = { 0., 0. };
+  // Deadbanded, unfiltered wrench. Scratch space of getFT
+  Vector6d biased_ft_;
 };
 }
 #endif
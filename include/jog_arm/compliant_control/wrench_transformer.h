@@ -0,0 +1,104 @@
+#ifndef WRENCH_TRANSFORMER_H
+#define WRENCH_TRANSFORMER_H
+
+/**
+ * Express force/torque sensor data in another frame, e.g. the end effector,
+ * without waiting on TF in the sensor callback.
+ */
+
+#include <Eigen/Geometry>
+#include <jog_arm/compliant_control/compliant_control.h>
+#include <jog_arm/support/triple_buffer.h>
+#include <ros/callback_queue.h>
+#include <ros/ros.h>
+#include <string>
+#include <tf2_ros/buffer.h>
+
+namespace compliant_control
+{
+typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+
+/**
+ * WrenchTransformMode enum.
+ * What changes when a wrench is expressed in the target frame.
+ */
+enum WrenchTransformMode
+{
+  FULL_ADJOINT = 0, /**< Torques are taken about the target origin. */
+  ROTATION_ONLY = 1 /**< Only the axes change. Torques stay about the source origin. */
+};
+
+/**
+ * Class WrenchTransformer - Transform wrenches by a cached frame transform.
+ *
+ * A wrench [f; tau] in the source frame becomes
+ * [R, 0; [p]x R, R] * [f; tau]
+ * in the target frame, where R and p are the rotation and the origin of the
+ * source frame in the target frame. The [p]x R block is the lever arm of the
+ * force about the target origin. With ROTATION_ONLY, the [p]x R block is
+ * left out.
+ *
+ * The 6x6 matrix is refreshed from TF by a timer with its own callback queue
+ * and thread, and handed to transform() through a TripleBuffer. transform()
+ * never waits on TF and doesn't allocate. Frames connected only by static
+ * transforms are looked up once and then the timer stops.
+ */
+class WrenchTransformer
+{
+public:
+  // refresh_period [s]: how often a moving transform is looked up. 0 --> only
+  // once, even if the transform isn't static.
+  WrenchTransformer(tf2_ros::Buffer& tf_buffer, const std::string& target_frame, const std::string& source_frame,
+                    double refresh_period, WrenchTransformMode mode = FULL_ADJOINT);
+
+  ~WrenchTransformer();
+
+  // Returns false, and leaves wrench_out unchanged, until the first transform
+  // was found
+  bool transform(const Vector6d& wrench_in, Vector6d& wrench_out);
+
+  // The wrench transform for a source frame at target_from_source
+  static Matrix6d adjoint(const Eigen::Isometry3d& target_from_source);
+
+  // The wrench transform that only rotates the axes of a source frame at
+  // target_from_source
+  static Matrix6d rotation(const Eigen::Isometry3d& target_from_source);
+
+  const std::string& targetFrame() const
+  {
+    return target_frame_;
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  // Timer callback. Keep the old transform if TF has nothing.
+  void refresh(const ros::TimerEvent&);
+
+  // Look up the latest transform without waiting. Sets static_frames_ if it
+  // has no timestamp, i.e. it only involves static transforms.
+  bool lookup(Matrix6d& adjoint);
+
+  tf2_ros::Buffer& tf_buffer_;
+
+  std::string target_frame_, source_frame_;
+
+  WrenchTransformMode mode_;
+
+  // Look up once. Set by refresh_period <= 0 or a static transform.
+  bool static_frames_;
+
+  // Refresh thread --> transform()
+  jog_arm::TripleBuffer<Matrix6d> adjoint_;
+
+  // Only touched by transform()
+  bool has_transform_;
+
+  ros::NodeHandle nh_;
+  ros::CallbackQueue refresh_queue_;
+  ros::AsyncSpinner refresh_spinner_;
+  ros::Timer refresh_timer_;
+};
+}
+
+#endif  // WRENCH_TRANSFORMER_H
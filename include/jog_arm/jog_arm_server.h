@@ -33,187 +33,438 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 // Server node for arm jogging with MoveIt.
-
 #ifndef JOG_ARM_SERVER_H
 #define JOG_ARM_SERVER_H
 
-#include <Eigen/Eigenvalues>
+#include <Eigen/Geometry>
+#include <atomic>
+#include <chrono>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <geometry_msgs/Twist.h>
+#include <geometry_msgs/WrenchStamped.h>
+#include <jog_arm/compliant_control/compliant_control.h>
+#include <jog_arm/compliant_control/wrench_transformer.h>
+#include <jog_arm/jog_core.h>
 #include <jog_arm/support/get_ros_params.h>
+#include <jog_arm/support/jacobian_solver.h>
+#include <jog_arm/support/latency_stats.h>
+#include <jog_arm/support/realtime.h>
+#include <jog_arm/support/spsc_ring.h>
+#include <jog_arm/support/triple_buffer.h>
+#include <jog_arm/support/wakeup_signal.h>
 #include <math.h>
-#include <moveit/move_group_interface/move_group_interface.h>
+#include <memory>
 #include <moveit/planning_scene/planning_scene.h>
-#include <moveit/planning_scene_interface/planning_scene_interface.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit_msgs/GetPlanningScene.h>
+#include <moveit_msgs/PlanningScene.h>
 #include <pthread.h>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <sensor_msgs/JointState.h>
 #include <sensor_msgs/Joy.h>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <string>
 #include <tf/transform_listener.h>
+#include <tf2_ros/transform_listener.h>
 #include <trajectory_msgs/JointTrajectory.h>
+#include <vector>
 
 namespace jog_arm
 {
-// For jogging calc thread
-void* joggingPipeline(void* threadid);
-
-// For collision checking thread
-void* collisionCheck(void* threadid);
+// For jogging calc threads. The argument is a JogWorker.
+void* joggingPipeline(void* worker);
 
-// Shared variables
-geometry_msgs::TwistStamped g_cmd_deltas;
-pthread_mutex_t g_cmd_deltas_mutex;
+// For the collision checking thread. The argument is a JogArmServer.
+void* collisionCheck(void* server);
 
-sensor_msgs::JointState g_joints;
-pthread_mutex_t g_joints_mutex;
+/**
+ * CommandOutType enum.
+ * The msg type published on cmd_out_topic.
+ */
+enum CommandOutType
+{
+  CMD_OUT_TRAJECTORY = 0,     /**< trajectory_msgs::JointTrajectory with lookahead points. */
+  CMD_OUT_POSITION_ARRAY = 1, /**< std_msgs::Float64MultiArray of joint positions, e.g. for a
+                                   JointGroupPositionController. */
+  CMD_OUT_VELOCITY_ARRAY = 2  /**< std_msgs::Float64MultiArray of joint velocities, e.g. for a
+                                   JointGroupVelocityController. */
+};
 
-trajectory_msgs::JointTrajectory g_new_traj;
-pthread_mutex_t g_new_traj_mutex;
+// ROS params of the in-process compliance of one MoveGroup
+struct ComplianceParameters
+{
+  bool enable;
+  std::string wrench_topic, sensor_frame, ee_frame;
+  std::vector<double> stiffness, deadband, end_condition_wrench;
+  double filter_coeff, highest_allowable_force, highest_allowable_torque;
+};
 
-bool g_imminent_collision(false);
-pthread_mutex_t g_imminent_collision_mutex;
+/**
+ * CmdCoalescing enum.
+ * How the cmds that arrived since the previous calculation are combined.
+ */
+enum CmdCoalescing
+{
+  COALESCE_LATEST = 0,   /**< Only the newest cmd. */
+  COALESCE_AVERAGE = 1,  /**< The mean of the cmds. */
+  COALESCE_INTEGRATE = 2 /**< The mean weighted by the time since the previous cmd, so the motion follows the
+                              integral of the input even if its rate varies. */
+};
 
-bool g_zero_trajectory_flag(false);
-pthread_mutex_t g_zero_trajectory_flagmutex;
+// A cartesian cmd on its way to JogCalcs. Unlike the msg, it is copied without
+// allocating.
+struct TimedTwist
+{
+  ros::Time stamp;
+  double twist[6];  // linear xyz, angular xyz
+};
 
-// ROS subscriber callbacks
-void deltaCmdCB(const geometry_msgs::TwistStampedConstPtr& msg);
-void jointsCB(const sensor_msgs::JointStateConstPtr& msg);
+// ROS params of one jogged MoveGroup. Those of the calculations are in
+// JogCoreParameters.
+struct JogArmParameters : public JogCoreParameters
+{
+  std::string cmd_in_topic, cmd_frame, cmd_out_topic, planning_frame, warning_topic;
+  double incoming_cmd_timeout;
+  int lookahead_points;
+  CommandOutType command_out_type;
+  CmdCoalescing cmd_coalescing;
+  bool coll_check;
+  ComplianceParameters compliance;
+};
 
-// ROS params to be read
-int readParams(ros::NodeHandle& n);
-std::string g_move_group_name, g_joint_topic, g_cmd_in_topic, g_cmd_frame, g_cmd_out_topic, g_planning_frame,
-    g_warning_topic;
-double g_linear_scale, g_rot_scale, g_singularity_threshold, g_hard_stop_sing_thresh, g_low_pass_filter_coeff,
-    g_pub_period, g_incoming_cmd_timeout;
-bool g_simu, g_coll_check;
+// Read the params of one MoveGroup, typically from YAML file.
+// Params in group_ns override those in shared_ns.
+int readParams(ros::NodeHandle& n, const std::string& shared_ns, const std::string& group_ns,
+               JogArmParameters& params);
 
 /**
- * Class LowPassFilter - Filter the joint velocities to avoid jerky motion.
+ * Class JogArmGroup - Params and shared variables of one jogged MoveGroup.
+ * Each channel has exactly one writer and one reader.
  */
-class LowPassFilter
+class JogArmGroup
 {
 public:
-  LowPassFilter(double low_pass_filter_coeff);
-  double filter(const double& new_msrmt);
-  void reset(double data);
-  double filter_coeff_ = 10.;
+  // Listen to cartesian delta commands
+  void deltaCmdCB(const geometry_msgs::TwistStampedConstPtr& msg);
 
-private:
-  double prev_msrmts_[3] = { 0., 0., 0. };
-  double prev_filtered_msrmts_[2] = { 0., 0. };
+  // Listen to force/torque data. Only with compliance enabled.
+  void wrenchCB(const geometry_msgs::WrenchStampedConstPtr& msg);
+
+  JogArmParameters params;
+
+  // Enough for a 1 kHz input while the calculations stall for a quarter second
+  static const std::size_t CMD_RING_SIZE = 256;
+
+  // deltaCmdCB, or wrenchCB with compliance enabled --> JogCalcs. Every cmd,
+  // combined by JogCalcs per params.cmd_coalescing.
+  SpscRing<TimedTwist, CMD_RING_SIZE> cmd_ring;
+
+  // deltaCmdCB --> wrenchCB. The nominal velocity of compliance.
+  TripleBuffer<geometry_msgs::TwistStamped> nominal_cmd;
+
+  // JogArmServer::jointsCB --> JogCalcs
+  TripleBuffer<sensor_msgs::JointState> joints;
+
+  // JogCalcs --> JogArmServer::publishTrajectories
+  TripleBuffer<trajectory_msgs::JointTrajectoryPtr> new_traj;
+
+  // JogCalcs --> CollisionCheck
+  TripleBuffer<sensor_msgs::JointState> commanded_joints;
+
+  std::atomic<bool> imminent_collision{ false };
+
+  std::atomic<bool> zero_trajectory_flag{ false };
+
+  // Stages of JogCalcs::jogCalcs. Recorded by the worker, summarized by
+  // JogArmServer::publishDiagnostics.
+  JogLatencies latencies;
+
+  // Wakes the worker that runs this group's calculations
+  WakeupSignal* calc_wakeup = nullptr;
+
+  ros::Subscriber cmd_sub;
+
+  // Publishes msgs of params.command_out_type
+  ros::Publisher cmd_out_pub;
+
+  // Only used by JogArmServer::publishTrajectories. Preallocated array cmd in
+  // the joint order of the MoveGroup.
+  std_msgs::Float64MultiArray array_cmd;
+
+  // In-process compliance. Only used by wrenchCB. Null if disabled.
+  std::unique_ptr<compliant_control::CompliantControl> compliance;
+  // sensor_frame --> ee_frame, then only rotated to cmd_frame, so torques
+  // are about the EE
+  std::unique_ptr<compliant_control::WrenchTransformer> sensor_to_ee_transformer;
+  std::unique_ptr<compliant_control::WrenchTransformer> ee_to_cmd_transformer;
+  ros::Subscriber wrench_sub;
+
+  // Tare of the sensor, in the sensor frame
+  compliant_control::Vector6d compliance_bias;
+  bool compliance_biased = false;
+
+  // Only used by JogArmServer::publishTrajectories. The cmd stamp of the
+  // newest trajectory and the buffer for republishing it.
+  ros::Time traj_cmd_stamp;
+  trajectory_msgs::JointTrajectoryPtr repeated_traj;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
-LowPassFilter::LowPassFilter(double low_pass_filter_coeff)
+/**
+ * Class JogWorker - One jogging calc thread. Runs the calculations for one or
+ * more MoveGroups whenever their inputs change.
+ */
+class JogWorker
 {
-  filter_coeff_ = low_pass_filter_coeff;
-}
+public:
+  pthread_t thread;
 
-void LowPassFilter::reset(double data)
-{
-  prev_msrmts_[0] = data;
-  prev_msrmts_[1] = data;
-  prev_msrmts_[2] = data;
+  // Notified by the callbacks of every group in groups
+  WakeupSignal wakeup;
+
+  std::vector<JogArmGroup*> groups;
+
+  // Shared by all groups of the server
+  ros::NodeHandle nh;
+  robot_model::RobotModelConstPtr kinematic_model;
+  tf::TransformListener* listener = nullptr;
+  double min_calc_period = 0.;
 
-  prev_filtered_msrmts_[0] = data;
-  prev_filtered_msrmts_[1] = data;
-}
+  // Set by the server to end the thread
+  const std::atomic<bool>* stop_requested = nullptr;
+
+  // Time spent enforcing min_calc_period
+  LatencyStats throttle_wait;
+};
 
-double LowPassFilter::filter(const double& new_msrmt)
+/**
+ * Class JogArmServer - Jog one or more MoveGroups of a robot.
+ * The robot model, the joint state subscription and the TF listener are shared
+ * by all groups. The calculations run on a pool of worker threads.
+ * Runs in its own node or as a nodelet, see jog_arm_server_node.cpp and
+ * jog_arm_server_nodelet.cpp.
+ */
+class JogArmServer
 {
-  // Push in the new measurement
-  prev_msrmts_[2] = prev_msrmts_[1];
-  prev_msrmts_[1] = prev_msrmts_[0];
-  prev_msrmts_[0] = new_msrmt;
+public:
+  // private_n holds the optional parameter_ns param
+  JogArmServer(ros::NodeHandle& n, ros::NodeHandle& private_n);
+
+  ~JogArmServer();
+
+  // Read params, load the robot model and start the worker threads.
+  // Returns 1 on failure.
+  int start();
+
+  // Stop and join the worker threads
+  void stop();
+
+  const std::string& jointTopic() const;
+
+  // Publish the newest trajectory of every group
+  void publishTrajectories();
+
+  // The fastest publish period of all groups
+  double pubPeriod() const;
+
+private:
+  friend void* collisionCheck(void* server);
+
+  // Listen to joint angles. Shared by all groups
+  void jointsCB(const sensor_msgs::JointStateConstPtr& msg);
+
+  // Publish the latency summaries on /diagnostics
+  void publishDiagnostics(const ros::TimerEvent&);
+
+  ros::NodeHandle nh_, private_nh_;
+
+  std::vector<std::unique_ptr<JogArmGroup> > groups_;
+
+  // jointsCB --> CollisionCheck
+  TripleBuffer<sensor_msgs::JointState> collision_joints_;
+
+  robot_model::RobotModelPtr kinematic_model_;
+
+  std::string joint_topic_;
+
+  robot_model_loader::RobotModelLoaderPtr model_loader_;
+
+  std::unique_ptr<tf::TransformListener> listener_;
+
+  // For the wrench transforms of compliance. Only created if a group needs it.
+  std::unique_ptr<tf2_ros::Buffer> tf2_buffer_;
+  std::unique_ptr<tf2_ros::TransformListener> tf2_listener_;
 
-  double new_filtered_msrmt = (1 / (1 + filter_coeff_ * filter_coeff_ + 1.414 * filter_coeff_)) *
-                              (prev_msrmts_[2] + 2 * prev_msrmts_[1] + prev_msrmts_[0] -
-                               (filter_coeff_ * filter_coeff_ - 1.414 * filter_coeff_ + 1) * prev_filtered_msrmts_[1] -
-                               (-2 * filter_coeff_ * filter_coeff_ + 2) * prev_filtered_msrmts_[0]);
+  std::vector<std::unique_ptr<JogWorker> > workers_;
 
-  // Store the new filtered measurement
-  prev_filtered_msrmts_[1] = prev_filtered_msrmts_[0];
-  prev_filtered_msrmts_[0] = new_filtered_msrmt;
+  pthread_t collision_thread_;
+  bool collision_thread_started_;
 
-  return new_filtered_msrmt;
-}
+  std::atomic<bool> stop_requested_{ false };
+
+  ros::Subscriber joints_sub_;
+
+  double min_calc_period_;
+
+  // Scheduling of the worker threads and of the collision thread
+  ThreadSettings jog_thread_settings_, collision_thread_settings_;
+  bool lock_memory_;
+
+  // 0 --> no latency summaries
+  double diagnostics_period_;
+  ros::Publisher diagnostics_pub_;
+  ros::Timer diagnostics_timer_;
+
+  LatencyStats collision_latency_, publish_latency_, publish_interval_;
+  std::chrono::steady_clock::time_point prev_publish_time_;
+};
 
 /**
- * Class JogCalcs - Perform the Jacobian calculations.
+ * Class JogCalcs - ROS shell around the JogCore of one MoveGroup. Parses the
+ * incoming msgs, converts the cmd frame and shares the resulting trajectory.
  */
 class JogCalcs
 {
 public:
-  JogCalcs(const std::string& move_group_name);
+  // The publisher and the timer are created from nh, the server's NodeHandle
+  JogCalcs(const ros::NodeHandle& nh, JogArmGroup& group, const robot_model::RobotModelConstPtr& kinematic_model,
+           tf::TransformListener& listener);
+
+  // Process the new cmds and the newest joints. Does nothing if neither changed.
+  void update();
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
 protected:
   ros::NodeHandle nh_;
 
-  moveit::planning_interface::MoveGroupInterface arm_;
+  JogArmGroup& group_;
+
+  const JogArmParameters& params_;
 
+  // The cmds of the last drainCmds(), combined
   geometry_msgs::TwistStamped cmd_deltas_;
 
+  // Of the newest cmd taken from the ring
+  ros::Time prev_cmd_stamp_;
+
   sensor_msgs::JointState incoming_jts_;
 
-  typedef Eigen::Matrix<double, 6, 1> Vector6d;
+  typedef JogCore::Vector6d Vector6d;
 
   void jogCalcs(const geometry_msgs::TwistStamped& cmd);
 
-  // Parse the incoming joint msg for the joints of our MoveGroup
-  void updateJoints();
+  // Combine the cmds waiting in the ring into cmd_deltas_. Returns false if
+  // there were none.
+  bool drainCmds();
 
-  Vector6d scaleCommand(const geometry_msgs::TwistStamped& command) const;
+  // Parse the incoming joint msg for the joints of our MoveGroup.
+  // Returns false if some of them are missing.
+  bool updateJoints();
 
-  Eigen::MatrixXd pseudoInverse(const Eigen::MatrixXd& J) const;
+  bool jointIndexMapValid() const;
 
-  bool addJointIncrements(sensor_msgs::JointState& output, const Eigen::VectorXd& increments) const;
+  // Recompute joint_index_map_ for the layout of incoming_jts_
+  bool updateJointIndexMap();
 
-  bool updateJointVels(sensor_msgs::JointState& output, const Eigen::VectorXd& joint_vels) const;
+  // Look up the latest cmd_frame --> planning_frame transform without waiting
+  bool lookupCmdFrameTransform(Eigen::Isometry3d& transform);
 
-  double checkConditionNumber(const Eigen::MatrixXd& matrix) const;
+  // Cache the transform for the first time and refresh it from now on if the
+  // frames move. Returns false if TF doesn't have it yet.
+  bool resolveCmdFrame();
 
-  // Reset the data stored in low-pass filters so the trajectory won't jump when
-  // jogging is resumed.
-  void resetVelocityFilters();
+  // Timer callback. Refresh the cached transform of a moving cmd_frame.
+  void updateCmdFrameTransform(const ros::TimerEvent&);
 
-  // Halt the robot
-  void halt(trajectory_msgs::JointTrajectory& jt_traj);
+  // An outgoing msg that is not in use by another thread
+  trajectory_msgs::JointTrajectoryPtr acquireTrajectory();
 
-  const robot_state::JointModelGroup* joint_model_group_;
+  trajectory_msgs::JointTrajectoryPtr allocateTrajectory() const;
 
-  robot_state::RobotStatePtr kinematic_state_;
+  // The numeric pipeline
+  JogCore core_;
 
-  sensor_msgs::JointState jt_state_, orig_jts_;
+  // The measured joints of our MoveGroup
+  sensor_msgs::JointState jt_state_;
 
-  tf::TransformListener listener_;
+  // joint_index_map_[i] is the index of jt_state_.name[i] in the incoming
+  // joint msg, which had incoming_layout_size_ joints when the map was built
+  std::vector<std::size_t> joint_index_map_;
+  std::size_t incoming_layout_size_ = 0;
 
-  ros::Time prev_time_;
+  // Shared by all groups
+  tf::TransformListener& listener_;
 
-  double delta_t_;
+  // Cached cmd_frame --> planning_frame transform. Resolved once if the frames
+  // are connected by static transforms, otherwise refreshed by a timer that
+  // runs outside the jogging thread.
+  TripleBuffer<Eigen::Isometry3d> cmd_frame_transform_;
+  ros::Timer cmd_frame_timer_;
+  bool cmd_frame_resolved_ = false;
 
-  std::vector<jog_arm::LowPassFilter> velocity_filters_;
-  std::vector<jog_arm::LowPassFilter> position_filters_;
+  ros::Time prev_time_;
+
+  // The position filters start from the first joint msg
+  bool position_filters_initialized_ = false;
 
   // Check whether incoming cmds are stale. Pause if so
   ros::Duration time_of_incoming_cmd_;
 
   ros::Publisher warning_pub_;
+
+  // Preallocated outgoing msgs, reused once no other thread holds them
+  std::vector<trajectory_msgs::JointTrajectoryPtr> traj_pool_;
 };
 
+/**
+ * Class CollisionCheck - Check the measured and commanded joints of every
+ * group against one shared collision world.
+ */
 class CollisionCheck
 {
 public:
-  CollisionCheck(const std::string& move_group_name);
+  // nh is the server's NodeHandle. Its copy gets a callback queue of its own.
+  CollisionCheck(const ros::NodeHandle& nh, const std::vector<JogArmGroup*>& groups,
+                 TripleBuffer<sensor_msgs::JointState>& joints, const robot_model::RobotModelConstPtr& kinematic_model,
+                 const std::string& joint_topic, const std::atomic<bool>& stop_requested,
+                 LatencyStats& cycle_latency);
 
 private:
+  // Collision status of one group
+  struct GroupStatus
+  {
+    JogArmGroup* group;
+    collision_detection::CollisionRequest collision_request;
+    bool measured_collision;
+    bool commanded_collision;
+    ros::Publisher warning_pub;
+  };
+
+  // Fetch the whole planning scene from move_group once, at startup
+  void requestPlanningScene();
+
+  // Apply a planning scene update from move_group
+  void planningSceneCB(const moveit_msgs::PlanningSceneConstPtr& msg);
+
   ros::NodeHandle nh_;
 
-  ros::Publisher warning_pub_;
+  // Planning scene msgs are queued here and handled by the collision thread
+  ros::CallbackQueue scene_queue_;
+
+  ros::Subscriber planning_scene_sub_;
+
+  // The collision world, owned by this thread
+  planning_scene::PlanningScenePtr planning_scene_;
+
+  // Incremented whenever the collision world changes
+  unsigned int world_version_;
 };
 
 }  // namespace jog_arm
 
-#endif  // JOG_ARM_SERVER_H
\ No newline at end of file
+#endif  // JOG_ARM_SERVER_H
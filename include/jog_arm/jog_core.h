@@ -0,0 +1,155 @@
+#ifndef JOG_CORE_H
+#define JOG_CORE_H
+
+/**
+ * The numeric jogging pipeline, free of ROS communication. Turns a twist and
+ * the measured joints of a MoveGroup into the next joint command.
+ */
+
+#include <Eigen/Dense>
+#include <jog_arm/support/chain_kinematics.h>
+#include <jog_arm/support/filter_bank.h>
+#include <jog_arm/support/jacobian_solver.h>
+#include <jog_arm/support/kinematics_kernel.h>
+#include <jog_arm/support/latency_stats.h>
+#include <memory>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <string>
+#include <vector>
+
+namespace jog_arm
+{
+// Params of the jogging calculations of one MoveGroup
+struct JogCoreParameters
+{
+  std::string move_group_name;
+  double linear_scale, rot_scale, singularity_threshold, hard_stop_sing_thresh, singularity_damping,
+      low_pass_filter_coeff, pub_period;
+};
+
+/**
+ * JogStatus enum.
+ * Outcome of one jogging cycle. Several flags may be set at once.
+ */
+enum JogStatus
+{
+  JOG_OK = 0,                /**< Moving as commanded. */
+  JOG_NEAR_SINGULARITY = 1,  /**< Slowed down close to a singularity. */
+  JOG_HALT_SINGULARITY = 2,  /**< Halted at a singularity. */
+  JOG_HALT_BOUNDS = 4,       /**< Halted at a position or velocity limit. */
+  JOG_HALT_COLLISION = 8,    /**< Halted because a collision is imminent. */
+  JOG_INVALID_INPUT = 16     /**< Wrong number of joints. Nothing calculated. */
+};
+
+// Latency of the stages of a jogging cycle. JogCore records the numeric
+// stages, the ROS shell the rest.
+struct JogLatencies
+{
+  LatencyStats tf_conversion, jacobian, pseudo_inverse, filtering, bounds_check, handoff, total;
+};
+
+/**
+ * Class JogCore - Jacobian-based jogging of one MoveGroup.
+ *
+ * Scales the twist, maps it to joint increments with the pseudo-inverse,
+ * filters the result and applies the singularity, bounds and collision checks.
+ * jog() does not allocate, so it can run in a realtime loop at hardware rate.
+ */
+class JogCore
+{
+public:
+  typedef JacobianSolver::Vector6d Vector6d;
+
+  JogCore(const robot_model::RobotModelConstPtr& kinematic_model, const JogCoreParameters& params);
+
+  // Variable names of the MoveGroup. All joint vectors are in this order.
+  const std::vector<std::string>& jointNames() const;
+
+  // Start the position filters from these joints, e.g. the first measurement
+  void resetPositionFilters(const std::vector<double>& positions);
+
+  // Reset the data stored in the velocity filters so the trajectory won't jump
+  // when jogging is resumed.
+  void resetVelocityFilters();
+
+  /**
+   * One jogging cycle.
+   * @param twist               Unscaled cmd in the planning frame: linear xyz, angular xyz.
+   * @param positions           Measured joints.
+   * @param delta_t             Time since the previous cycle [s].
+   * @param imminent_collision  Halt if true.
+   * @return                    JogStatus flags. The command is in positions()
+   *                            and velocities() unless JOG_INVALID_INPUT is set.
+   */
+  unsigned int jog(const Vector6d& twist, const std::vector<double>& positions, double delta_t,
+                   bool imminent_collision);
+
+  // The joint command of the last cycle
+  const std::vector<double>& positions() const
+  {
+    return positions_;
+  }
+  const std::vector<double>& velocities() const
+  {
+    return velocities_;
+  }
+
+  // The joint command of the last cycle continued at its velocities for
+  // time [s], within the position bounds. positions needs one entry per joint.
+  void extrapolate(double time, std::vector<double>& positions) const;
+
+  // Of the Jacobian of the last cycle
+  double conditionNumber() const
+  {
+    return jacobian_solver_.conditionNumber();
+  }
+
+  // Record the numeric stages of jog() here. nullptr --> don't record.
+  void setLatencyStats(JogLatencies* latencies)
+  {
+    latencies_ = latencies;
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  typedef JacobianSolver::Jacobian Jacobian;
+  typedef JacobianSolver::JointVector JointVector;
+
+  // Fill jacobian_ for these joints. Reuses its storage.
+  void updateJacobian(const std::vector<double>& positions);
+
+  // Hold the measured joints
+  void halt(const std::vector<double>& measured_positions);
+
+  JogCoreParameters params_;
+
+  const robot_state::JointModelGroup* joint_model_group_;
+
+  // Kinematics of the group alone, if it is a serial chain. Otherwise the
+  // Jacobian comes from a full RobotState. A generated kernel replaces the
+  // chain if there is one for this arm.
+  std::unique_ptr<ChainKinematics> chain_;
+  const KinematicsKernel* kernel_;
+  robot_state::RobotStatePtr kinematic_state_;
+
+  // Preallocated workspace for the jogging calculations
+  Eigen::MatrixXd moveit_jacobian_;
+  Jacobian jacobian_;
+  JointVector delta_theta_, joint_vel_;
+
+  // One SVD per cycle for the pseudo-inverse and the condition number
+  JacobianSolver jacobian_solver_;
+
+  // Low-pass filters for the joint positions & velocities, one channel per joint
+  FilterBank velocity_filters_, position_filters_;
+
+  std::vector<double> positions_, velocities_;
+
+  JogLatencies* latencies_;
+};
+
+}  // namespace jog_arm
+
+#endif  // JOG_CORE_H
@@ -0,0 +1,104 @@
+#ifndef CHAIN_KINEMATICS_H
+#define CHAIN_KINEMATICS_H
+
+/**
+ * Forward kinematics and Jacobian of a serial MoveGroup, without updating the
+ * rest of the robot.
+ */
+
+#include <Eigen/Geometry>
+#include <jog_arm/support/jacobian_solver.h>
+#include <moveit/robot_model/robot_model.h>
+#include <string>
+#include <vector>
+
+namespace jog_arm
+{
+/**
+ * Class ChainKinematics - Kinematics of the links between the root and the tip
+ * of one MoveGroup.
+ *
+ * The chain runs from the parent link of the first joint of the group to its
+ * last link, the link whose Jacobian MoveIt would return. Fixed joints along
+ * the way are folded into the constant offsets between the joints. Only
+ * single-variable revolute and prismatic joints are supported.
+ *
+ * update() keeps the transform of every joint frame and recomputes only those
+ * from the first changed joint on. The tip transform and the Jacobian are
+ * expressed in the root frame, like those of RobotState::getJacobian. Nothing
+ * allocates after construction.
+ */
+class ChainKinematics
+{
+public:
+  typedef JacobianSolver::Jacobian Jacobian;
+
+  // Throws std::invalid_argument if the group is not a serial chain of
+  // revolute and prismatic joints, or has more than MAX_DOF joints.
+  explicit ChainKinematics(const robot_model::JointModelGroup* joint_model_group);
+
+  // positions holds one entry per variable of the group, in group order.
+  // Returns the number of joint frames that were recomputed.
+  std::size_t update(const double* positions);
+
+  // Of the tip link, in the root frame
+  const Eigen::Isometry3d& tipTransform() const
+  {
+    return tip_transform_;
+  }
+
+  // 6xN Jacobian of the tip link origin, linear rows first
+  void jacobian(Jacobian& jacobian) const;
+
+  const std::string& rootLinkName() const
+  {
+    return root_link_name_;
+  }
+
+  const std::string& tipLinkName() const
+  {
+    return tip_link_name_;
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  // One moving joint of the chain
+  struct Segment
+  {
+    // From the previous joint frame, after its motion, to this one. Includes
+    // the fixed joints in between.
+    Eigen::Isometry3d offset;
+
+    // In this joint frame
+    Eigen::Vector3d axis;
+
+    bool prismatic;
+
+    // Index of the joint variable in the group
+    int variable_index;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  std::vector<Segment, Eigen::aligned_allocator<Segment> > segments_;
+
+  // From the last joint frame, after its motion, to the tip link
+  Eigen::Isometry3d tip_offset_;
+
+  // joint_frames_[i]: segment i's frame in the root frame, before its motion.
+  // moved_frames_[i]: the same after its motion.
+  std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > joint_frames_, moved_frames_;
+
+  Eigen::Isometry3d tip_transform_;
+
+  // The positions of the last update(), in segment order
+  JacobianSolver::JointVector positions_;
+  bool initialized_;
+
+  std::string root_link_name_, tip_link_name_;
+};
+
+}  // namespace jog_arm
+
+#endif  // CHAIN_KINEMATICS_H
@@ -0,0 +1,103 @@
+#ifndef FILTER_BANK_H
+#define FILTER_BANK_H
+
+/**
+ * Second-order low-pass filtering of many channels at once, e.g. every joint
+ * of a MoveGroup or every dimension of a wrench.
+ */
+
+#include <Eigen/Core>
+
+namespace jog_arm
+{
+/**
+ * Class FilterBank - The same Butterworth-like low-pass filter on N channels.
+ *
+ * y[n] = (x[n] + 2 x[n-1] + x[n-2] - (c^2 - 1.414 c + 1) y[n-2] - (2 - 2 c^2) y[n-1]) / (1 + c^2 + 1.414 c)
+ *
+ * Related to the cutoff frequency of the filter, c = 1 results in a cutoff at
+ * 1/4 of the sampling rate. Larger c --> trust the filtered data more, trust
+ * the measurements less.
+ *
+ * The coefficients are computed once. The history of all channels is stored as
+ * one array per tap, so filter() updates every channel in one vectorized pass.
+ * Only the constructor allocates.
+ */
+class FilterBank
+{
+public:
+  FilterBank(int num_channels, double filter_coeff)
+    : prev_msrmts_1_(Eigen::ArrayXd::Zero(num_channels))
+    , prev_msrmts_2_(Eigen::ArrayXd::Zero(num_channels))
+    , prev_filtered_msrmts_1_(Eigen::ArrayXd::Zero(num_channels))
+    , prev_filtered_msrmts_2_(Eigen::ArrayXd::Zero(num_channels))
+    , input_sum_(num_channels)
+  {
+    setFilterCoeff(filter_coeff);
+  }
+
+  int numChannels() const
+  {
+    return static_cast<int>(prev_msrmts_1_.size());
+  }
+
+  void setFilterCoeff(double filter_coeff)
+  {
+    const double gain = 1. / (1. + filter_coeff * filter_coeff + 1.414 * filter_coeff);
+    input_gain_ = gain;
+    filtered_gain_1_ = gain * (-2. * filter_coeff * filter_coeff + 2.);
+    filtered_gain_2_ = gain * (filter_coeff * filter_coeff - 1.414 * filter_coeff + 1.);
+  }
+
+  // Filter one sample of every channel. input and output hold numChannels()
+  // values and may be the same array.
+  void filter(const double* input, double* output)
+  {
+    const Eigen::Map<const Eigen::ArrayXd> new_msrmts(input, numChannels());
+
+    input_sum_ = new_msrmts + 2. * prev_msrmts_1_ + prev_msrmts_2_;
+    prev_msrmts_2_ = prev_msrmts_1_;
+    prev_msrmts_1_ = new_msrmts;
+
+    // The oldest filtered value is overwritten by the newest one. Swapping only
+    // exchanges the data pointers.
+    prev_filtered_msrmts_2_ = input_gain_ * input_sum_ - filtered_gain_1_ * prev_filtered_msrmts_1_ -
+                              filtered_gain_2_ * prev_filtered_msrmts_2_;
+    prev_filtered_msrmts_1_.swap(prev_filtered_msrmts_2_);
+
+    Eigen::Map<Eigen::ArrayXd>(output, numChannels()) = prev_filtered_msrmts_1_;
+  }
+
+  // Settle every channel at this value
+  void reset(double data)
+  {
+    prev_msrmts_1_.setConstant(data);
+    prev_msrmts_2_.setConstant(data);
+    prev_filtered_msrmts_1_.setConstant(data);
+    prev_filtered_msrmts_2_.setConstant(data);
+  }
+
+  // Settle each channel at its own value. data holds numChannels() values.
+  void reset(const double* data)
+  {
+    const Eigen::Map<const Eigen::ArrayXd> values(data, numChannels());
+    prev_msrmts_1_ = values;
+    prev_msrmts_2_ = values;
+    prev_filtered_msrmts_1_ = values;
+    prev_filtered_msrmts_2_ = values;
+  }
+
+private:
+  double input_gain_, filtered_gain_1_, filtered_gain_2_;
+
+  // One entry per channel
+  Eigen::ArrayXd prev_msrmts_1_, prev_msrmts_2_;
+  Eigen::ArrayXd prev_filtered_msrmts_1_, prev_filtered_msrmts_2_;
+
+  // Scratch space of filter()
+  Eigen::ArrayXd input_sum_;
+};
+
+}  // namespace jog_arm
+
+#endif  // FILTER_BANK_H
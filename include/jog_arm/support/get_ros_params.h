@@ -37,6 +37,7 @@
 
 #include <ros/ros.h>
 #include <string>
+#include <vector>
 
 namespace get_ros_params
 {
@@ -44,6 +45,8 @@ std::string getStringParam(const std::string& name, ros::NodeHandle& n);
 double getDoubleParam(const std::string& name, ros::NodeHandle& n);
 double getIntParam(const std::string& name, ros::NodeHandle& n);
 bool getBoolParam(const std::string& name, ros::NodeHandle& n);
+std::vector<double> getDoubleArrayParam(const std::string& name, ros::NodeHandle& n);
+std::vector<int> getIntArrayParam(const std::string& name, ros::NodeHandle& n);
 }
 
 #endif  // GET_ROS_PARAMS_H
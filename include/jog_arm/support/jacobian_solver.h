@@ -0,0 +1,80 @@
+#ifndef JACOBIAN_SOLVER_H
+#define JACOBIAN_SOLVER_H
+
+/**
+ * Decompose a manipulator Jacobian once and reuse the result for both the
+ * pseudo-inverse and the singularity check.
+ */
+
+#include <Eigen/Dense>
+
+namespace jog_arm
+{
+/**
+ * Class JacobianSolver - One SVD per cycle.
+ *
+ * The singular values of the 6xN Jacobian give a damped pseudo-inverse,
+ * J^+ = V * diag(s / (s^2 + damping^2)) * U^T,
+ * and the condition number, max(s) / min(s). The condition number is well
+ * defined for non-square Jacobians, unlike one based on eigenvalues.
+ *
+ * All matrices have a compile-time upper bound of MAX_DOF joints, so compute()
+ * does not allocate.
+ */
+class JacobianSolver
+{
+public:
+  // Largest joint group handled
+  static const int MAX_DOF = 10;
+
+  typedef Eigen::Matrix<double, 6, 1> Vector6d;
+  typedef Eigen::Matrix<double, 6, Eigen::Dynamic, Eigen::ColMajor, 6, MAX_DOF> Jacobian;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::ColMajor, MAX_DOF, 6> JacobianInverse;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, MAX_DOF, 1> JointVector;
+
+  // damping = 0 gives the plain pseudo-inverse
+  explicit JacobianSolver(double damping = 0.);
+
+  // Decompose a new Jacobian
+  void compute(const Jacobian& jacobian);
+
+  // delta_theta = J^+ * delta_x, for the last Jacobian passed to compute()
+  void solve(const Vector6d& delta_x, JointVector& delta_theta) const;
+
+  const JacobianInverse& pseudoInverse() const
+  {
+    return pseudo_inverse_;
+  }
+
+  // Infinite if the Jacobian is singular
+  double conditionNumber() const
+  {
+    return condition_number_;
+  }
+
+  void setDamping(double damping)
+  {
+    damping_ = damping;
+  }
+
+private:
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, 6, 1> SingularValues;
+
+  // The SVD works on a matrix with a dynamic row count. Eigen's QR
+  // preconditioner can't handle a fixed row count with fewer columns than rows.
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, 6, MAX_DOF> SVDMatrix;
+
+  double damping_;
+
+  Eigen::JacobiSVD<SVDMatrix> svd_;
+
+  SingularValues inverted_singular_values_;
+
+  JacobianInverse pseudo_inverse_;
+
+  double condition_number_;
+};
+
+}  // namespace jog_arm
+
+#endif  // JACOBIAN_SOLVER_H
@@ -0,0 +1,43 @@
+#ifndef KINEMATICS_KERNEL_H
+#define KINEMATICS_KERNEL_H
+
+/**
+ * Closed-form kinematics of known arms, generated from their URDFs at build
+ * time by scripts/generate_kinematics.py.
+ */
+
+#include <jog_arm/support/chain_kinematics.h>
+#include <moveit/robot_model/robot_model.h>
+
+namespace jog_arm
+{
+// The kinematics of one serial chain. positions are in chain order, from the
+// base link to the tip link.
+struct KinematicsKernel
+{
+  const char* robot_name;
+  const char* base_link;
+  const char* tip_link;
+  unsigned int num_joints;
+  const char* const* joint_names;
+
+  // The tip transform in the base frame, a column-major 4x4 matrix
+  void (*forward)(const double* positions, double* transform);
+
+  // The 6xN Jacobian of the tip in the base frame, column-major, linear rows first
+  void (*jacobian)(const double* positions, double* jacobian);
+};
+
+/**
+ * The generated kernel for the chain of this MoveGroup, or nullptr.
+ * A kernel has to match the links and the joint order of the group, and its
+ * results have to match those of chain. So a URDF that changed after the build
+ * falls back to the generic kinematics.
+ * chain is left at arbitrary joint positions.
+ */
+const KinematicsKernel* findKinematicsKernel(const robot_model::JointModelGroup* joint_model_group,
+                                             ChainKinematics& chain);
+
+}  // namespace jog_arm
+
+#endif  // KINEMATICS_KERNEL_H
@@ -0,0 +1,91 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+/**
+ * Cheap latency histograms for the jogging pipeline. One thread records,
+ * another one periodically takes a summary.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace jog_arm
+{
+/**
+ * Class LatencyStats - Log-scaled histogram of durations.
+ *
+ * Buckets are 2^(1/4) wide, from 1 us to about 1 s, so percentiles are exact to
+ * within 19%. record() is wait-free and does not allocate. takeSummary()
+ * resets the histogram, so each summary covers the time since the previous one.
+ */
+class LatencyStats
+{
+public:
+  static const int NUM_BUCKETS = 80;
+
+  struct Summary
+  {
+    uint64_t count;
+    // [s]
+    double p50, p99, max;
+    // Number of durations longer than the deadline
+    uint64_t deadline_misses;
+  };
+
+  // deadline [s]. 0 --> no deadline
+  explicit LatencyStats(double deadline = 0.);
+
+  void setDeadline(double deadline);
+
+  // Writer: add one duration [s]
+  void record(double duration);
+
+  // Reader: summarize the durations since the last call and start over
+  Summary takeSummary();
+
+private:
+  // Upper bound of a bucket [s]
+  static double bucketLimit(int bucket);
+
+  std::array<std::atomic<uint32_t>, NUM_BUCKETS> buckets_;
+
+  std::atomic<uint64_t> max_ns_;
+
+  std::atomic<uint64_t> deadline_misses_;
+
+  std::atomic<double> deadline_;
+};
+
+/**
+ * Class Stopwatch - Time consecutive stages of a calculation.
+ */
+class Stopwatch
+{
+public:
+  Stopwatch() : start_(std::chrono::steady_clock::now()), lap_start_(start_)
+  {
+  }
+
+  // Record the time since the previous lap, or since construction
+  void lap(LatencyStats& stats)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    stats.record(std::chrono::duration<double>(now - lap_start_).count());
+    lap_start_ = now;
+  }
+
+  // Record the time since construction
+  void total(LatencyStats& stats) const
+  {
+    stats.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_, lap_start_;
+};
+
+}  // namespace jog_arm
+
+#endif  // LATENCY_STATS_H
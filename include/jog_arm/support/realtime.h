@@ -0,0 +1,34 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+/**
+ * Scheduling of the jogging threads on a realtime (e.g. PREEMPT_RT) kernel.
+ */
+
+#include <pthread.h>
+#include <vector>
+
+namespace jog_arm
+{
+// How one thread is scheduled
+struct ThreadSettings
+{
+  // SCHED_FIFO priority, 1-99. 0 --> the normal scheduler.
+  int priority = 0;
+
+  // Run only on these CPUs. Empty --> any CPU.
+  std::vector<int> cpus;
+};
+
+// pthread_create with the given settings. Returns 0 or the error number of
+// the pthread call that failed, e.g. EPERM without the privileges for
+// SCHED_FIFO. No thread is created on failure.
+int createThread(pthread_t* thread, const ThreadSettings& settings, void* (*routine)(void*), void* arg);
+
+// Lock all current and future pages of the process in RAM, so the realtime
+// threads don't take page faults. Returns 0 or the error number.
+int lockMemory();
+
+}  // namespace jog_arm
+
+#endif  // REALTIME_H
@@ -0,0 +1,85 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+/**
+ * Lock-free FIFO of values from one writer thread to one reader thread.
+ */
+
+#include <atomic>
+#include <cstddef>
+
+namespace jog_arm
+{
+/**
+ * Class SpscRing - Single-writer, single-reader queue of fixed capacity.
+ *
+ * Unlike TripleBuffer, every value is kept until the reader takes it. The
+ * writer never waits: push() fails if the reader fell N values behind.
+ *
+ * The storage is part of the object and values are handed over by
+ * copy-assignment, so no allocation takes place.
+ */
+template <typename T, std::size_t N>
+class SpscRing
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "The capacity of SpscRing must be a power of two");
+
+public:
+  SpscRing() : buffers_(), head_(0), tail_(0)
+  {
+  }
+
+  // Writer: append a copy of value. Returns false, dropping it, if the ring
+  // is full.
+  bool push(const T& value)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == N)
+      return false;
+
+    buffers_[head & INDEX_MASK] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Reader: take the oldest value. Returns false if the ring is empty.
+  bool pop(T& value)
+  {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+
+    value = buffers_[tail & INDEX_MASK];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Number of values waiting. Exact only on the reader side.
+  std::size_t size() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  static std::size_t capacity()
+  {
+    return N;
+  }
+
+private:
+  static const std::size_t INDEX_MASK = N - 1;
+
+  T buffers_[N];
+
+  // Count of values pushed. Only written by the writer.
+  std::atomic<std::size_t> head_;
+
+  // Keep the indices of the two threads on separate cache lines
+  char padding_[64];
+
+  // Count of values popped. Only written by the reader.
+  std::atomic<std::size_t> tail_;
+};
+
+}  // namespace jog_arm
+
+#endif  // SPSC_RING_H
@@ -0,0 +1,92 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+/**
+ * Lock-free hand-off of the newest value of a type from one writer thread to
+ * one reader thread.
+ */
+
+#include <atomic>
+#include <cstdint>
+
+namespace jog_arm
+{
+/**
+ * Class TripleBuffer - Single-writer, single-reader snapshot channel.
+ *
+ * The writer fills a private back buffer and publishes it by swapping it with
+ * the shared middle buffer. The reader swaps the middle buffer into its private
+ * front buffer only when something new was published. Neither side ever waits
+ * on the other and intermediate values are dropped, so the reader always sees
+ * the latest complete snapshot.
+ *
+ * Values are handed over by copy-assignment into a buffer that is reused every
+ * cycle, so once the buffers have grown to the message size no allocation
+ * takes place.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() : state_(1), back_(0), front_(2)
+  {
+  }
+
+  // Writer: the buffer to fill before calling publish()
+  T& writeBuffer()
+  {
+    return buffers_[back_];
+  }
+
+  // Writer: make the back buffer visible to the reader
+  void publish()
+  {
+    const uint8_t prev = state_.exchange(static_cast<uint8_t>(back_ | NEW_DATA_BIT), std::memory_order_acq_rel);
+    back_ = prev & INDEX_MASK;
+  }
+
+  // Writer: copy a value in and publish it
+  void write(const T& value)
+  {
+    buffers_[back_] = value;
+    publish();
+  }
+
+  // Reader: fetch the newest value, if any. Returns true if the front buffer
+  // changed since the previous call.
+  bool update()
+  {
+    if (!(state_.load(std::memory_order_acquire) & NEW_DATA_BIT))
+      return false;
+
+    const uint8_t prev = state_.exchange(front_, std::memory_order_acq_rel);
+    front_ = prev & INDEX_MASK;
+    return true;
+  }
+
+  // Reader: the latest value fetched by update(). Owned by the reader until the
+  // next update().
+  T& get()
+  {
+    return buffers_[front_];
+  }
+
+private:
+  static const uint8_t INDEX_MASK = 0x3;
+  static const uint8_t NEW_DATA_BIT = 0x4;
+
+  T buffers_[3];
+
+  // Index of the middle buffer and the new-data flag
+  std::atomic<uint8_t> state_;
+
+  // Only touched by the writer
+  uint8_t back_;
+
+  // Only touched by the reader
+  uint8_t front_;
+};
+
+}  // namespace jog_arm
+
+#endif  // TRIPLE_BUFFER_H
@@ -0,0 +1,97 @@
+#ifndef WAKEUP_SIGNAL_H
+#define WAKEUP_SIGNAL_H
+
+/**
+ * Let a worker thread sleep until a producer has something new for it.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+namespace jog_arm
+{
+/**
+ * Class WakeupSignal - A condition variable with a sticky flag.
+ *
+ * notify() may be called from any thread at any time. A notification that
+ * arrives while nobody is waiting is remembered, so the next wait() returns
+ * immediately. Several notifications before a wait() collapse into one.
+ */
+class WakeupSignal
+{
+public:
+  WakeupSignal() : pending_(false)
+  {
+    // Priority inheritance: a low-priority notifier holding the mutex is
+    // boosted instead of blocking a realtime waiter
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setprotocol(&mutex_attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&mutex_, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
+    // Timeouts are measured on the monotonic clock so they are immune to
+    // changes of the system time
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond_, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+  }
+
+  ~WakeupSignal()
+  {
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  // Wake the waiting thread
+  void notify()
+  {
+    pthread_mutex_lock(&mutex_);
+    pending_ = true;
+    pthread_mutex_unlock(&mutex_);
+    pthread_cond_signal(&cond_);
+  }
+
+  // Block until notify() is called or timeout [s] elapses.
+  // Returns true if notified.
+  bool wait(double timeout)
+  {
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    const long timeout_ns = static_cast<long>(timeout * 1e9);
+    deadline.tv_sec += timeout_ns / 1000000000L;
+    deadline.tv_nsec += timeout_ns % 1000000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&mutex_);
+    while (!pending_)
+    {
+      if (pthread_cond_timedwait(&cond_, &mutex_, &deadline) != 0)
+        break;
+    }
+    const bool notified = pending_;
+    pending_ = false;
+    pthread_mutex_unlock(&mutex_);
+
+    return notified;
+  }
+
+private:
+  // Not copyable
+  WakeupSignal(const WakeupSignal&);
+  WakeupSignal& operator=(const WakeupSignal&);
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  bool pending_;
+};
+
+}  // namespace jog_arm
+
+#endif  // WAKEUP_SIGNAL_H
@@ -0,0 +1,323 @@
+#!/usr/bin/env python
+"""
+Generate closed-form forward kinematics and Jacobians of serial chains in URDFs.
+
+Writes one C++ header with a KinematicsKernel per chain. The code is straight
+line: the fixed transforms are folded into constants and only the joint
+motions are left as expressions.
+
+Usage: generate_kinematics.py -o <header> <urdf>,<base link>,<tip link> ...
+"""
+
+import argparse
+import math
+import os
+import re
+import sys
+import xml.etree.ElementTree as ElementTree
+
+
+class Joint(object):
+    def __init__(self, element):
+        self.name = element.get('name')
+        self.type = element.get('type')
+        self.parent = element.find('parent').get('link')
+        self.child = element.find('child').get('link')
+
+        origin = element.find('origin')
+        xyz = [0., 0., 0.]
+        rpy = [0., 0., 0.]
+        if origin is not None:
+            xyz = [float(v) for v in origin.get('xyz', '0 0 0').split()]
+            rpy = [float(v) for v in origin.get('rpy', '0 0 0').split()]
+        self.origin = (rpy_matrix(rpy), xyz)
+
+        axis = element.find('axis')
+        self.axis = [1., 0., 0.]
+        if axis is not None:
+            self.axis = [float(v) for v in axis.get('xyz').split()]
+            norm = math.sqrt(sum(a * a for a in self.axis))
+            self.axis = [a / norm for a in self.axis]
+
+
+def rpy_matrix(rpy):
+    """Rz(yaw) * Ry(pitch) * Rx(roll), as in URDF"""
+    cr, sr = math.cos(rpy[0]), math.sin(rpy[0])
+    cp, sp = math.cos(rpy[1]), math.sin(rpy[1])
+    cy, sy = math.cos(rpy[2]), math.sin(rpy[2])
+    return [[cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr],
+            [sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr],
+            [-sp, cp * sr, cp * cr]]
+
+
+def read_chain(urdf, base, tip):
+    """The robot name and the joints from base to tip"""
+    robot = ElementTree.parse(urdf).getroot()
+    joints = {}
+    for element in robot.findall('joint'):
+        joint = Joint(element)
+        joints[joint.child] = joint
+
+    chain = []
+    link = tip
+    while link != base:
+        if link not in joints:
+            raise ValueError('%s: %s is not below %s' % (urdf, tip, base))
+        joint = joints[link]
+        if joint.type not in ('revolute', 'continuous', 'prismatic', 'fixed'):
+            raise ValueError('%s: unsupported joint type %s of %s' % (urdf, joint.type, joint.name))
+        chain.append(joint)
+        link = joint.parent
+    chain.reverse()
+    return robot.get('name'), chain
+
+
+class Emitter(object):
+    """
+    Builds the body of one function.
+
+    An entry of a matrix is either a float constant or a (coefficient, name)
+    term. Sums of several terms become local variables, so every entry stays
+    cheap to reuse.
+    """
+
+    def __init__(self):
+        self.lines = []
+        self.count = 0
+
+    def variable(self, expression):
+        name = 't%d' % self.count
+        self.count += 1
+        self.lines.append('  const double %s = %s;' % (name, expression))
+        return name
+
+    def body(self, assignments):
+        """The variables the assignments need, followed by the assignments"""
+        used = set(re.findall(r'\bt\d+\b', ' '.join(assignments)))
+        needed = []
+        for line in reversed(self.lines):
+            name = line.split()[2]
+            if name in used:
+                used.update(re.findall(r'\bt\d+\b', line.split('=', 1)[1]))
+                needed.append(line)
+        return '\n'.join(list(reversed(needed)) + assignments)
+
+    @staticmethod
+    def product(a, b):
+        if isinstance(a, float) and isinstance(b, float):
+            return a * b
+        if isinstance(a, float):
+            a, b = b, a
+        if isinstance(b, float):
+            return 0. if b == 0. else (a[0] * b, a[1])
+        return (a[0] * b[0], a[1] + ' * ' + b[1])
+
+    def sum(self, entries):
+        """Add the entries, folding the constants"""
+        constant = 0.
+        terms = []
+        for entry in entries:
+            if isinstance(entry, float):
+                constant += entry
+            elif entry[0] != 0.:
+                terms.append(entry)
+        if not terms:
+            return constant
+        if len(terms) == 1 and constant == 0.:
+            return terms[0]
+
+        expression = ''
+        for coefficient, name in terms:
+            sign = ' - ' if coefficient < 0. else ' + '
+            magnitude = abs(coefficient)
+            factor = name if magnitude == 1. else '%s * %s' % (literal(magnitude), name)
+            if not expression:
+                expression = ('-' if coefficient < 0. else '') + factor
+            else:
+                expression += sign + factor
+        if constant != 0.:
+            expression += (' - ' if constant < 0. else ' + ') + literal(abs(constant))
+        return (1., self.variable(expression))
+
+    def multiply(self, a, b):
+        return [[self.sum([self.product(a[r][k], b[k][c]) for k in range(3)]) for c in range(3)] for r in range(3)]
+
+    def rotate(self, rotation, vector):
+        return [self.sum([self.product(rotation[r][k], vector[k]) for k in range(3)]) for r in range(3)]
+
+    def cross(self, a, b):
+        return [self.sum([self.product(a[(r + 1) % 3], b[(r + 2) % 3]),
+                          self.product(self.product(a[(r + 2) % 3], b[(r + 1) % 3]), -1.)]) for r in range(3)]
+
+    def axis_rotation(self, axis, index):
+        """The rotation of the joint with this variable index about axis"""
+        c = (1., self.variable('std::cos(q[%d])' % index))
+        s = (1., self.variable('std::sin(q[%d])' % index))
+        skew = [[0., -axis[2], axis[1]], [axis[2], 0., -axis[0]], [-axis[1], axis[0], 0.]]
+
+        # Along a coordinate axis, the rotation is the usual one with an
+        # exact 1 on the diagonal
+        if sorted(abs(a) for a in axis) == [0., 0., 1.]:
+            return [[(1. if abs(axis[r]) == 1. else c) if r == k else self.product(s, skew[r][k])
+                     for k in range(3)] for r in range(3)]
+
+        # Rodrigues: c * I + s * [axis]x + (1 - c) * axis * axis^T
+        one_minus_c = (1., self.variable('1. - %s' % c[1]))
+        rotation = [[None] * 3 for _ in range(3)]
+        for r in range(3):
+            for k in range(3):
+                rotation[r][k] = self.sum([self.product(c, 1. if r == k else 0.), self.product(s, skew[r][k]),
+                                           self.product(one_minus_c, axis[r] * axis[k])])
+        return rotation
+
+
+def literal(value):
+    text = '%.17g' % value
+    if '.' not in text and 'e' not in text:
+        text += '.'
+    return text
+
+
+def clean(value):
+    return 0. if abs(value) < 1e-15 else value
+
+
+def chain_kinematics(emitter, chain):
+    """Emit the FK of every joint. Returns the tip frame and, per moving joint,
+    its axis and origin in the base frame."""
+    rotation = [[1. if r == c else 0. for c in range(3)] for r in range(3)]
+    translation = [0., 0., 0.]
+    joints = []
+    index = 0
+    for joint in chain:
+        origin_rotation = [[clean(v) for v in row] for row in joint.origin[0]]
+        origin_translation = [clean(v) for v in joint.origin[1]]
+        offset = emitter.rotate(rotation, origin_translation)
+        translation = [emitter.sum([translation[r], offset[r]]) for r in range(3)]
+        rotation = emitter.multiply(rotation, origin_rotation)
+        if joint.type == 'fixed':
+            continue
+
+        axis = emitter.rotate(rotation, joint.axis)
+        joints.append((joint, axis, translation))
+        if joint.type == 'prismatic':
+            q = (1., 'q[%d]' % index)
+            translation = [emitter.sum([translation[r], emitter.product(axis[r], q)]) for r in range(3)]
+        else:
+            rotation = emitter.multiply(rotation, emitter.axis_rotation(joint.axis, index))
+        index += 1
+    return rotation, translation, joints
+
+
+def expression(entry):
+    if isinstance(entry, float):
+        return literal(entry)
+    if entry[0] == 1.:
+        return entry[1]
+    if entry[0] == -1.:
+        return '-' + entry[1]
+    return '%s * %s' % (literal(entry[0]), entry[1])
+
+
+def identifier(name):
+    return ''.join(c if c.isalnum() else '_' for c in name)
+
+
+def forward_function(name, chain):
+    emitter = Emitter()
+    rotation, translation, _ = chain_kinematics(emitter, chain)
+    body = []
+    for c in range(3):
+        for r in range(3):
+            body.append('  transform[%d] = %s;' % (4 * c + r, expression(rotation[r][c])))
+        body.append('  transform[%d] = 0.;' % (4 * c + 3))
+    for r in range(3):
+        body.append('  transform[%d] = %s;' % (12 + r, expression(translation[r])))
+    body.append('  transform[15] = 1.;')
+    return ('inline void %s_forward(const double* q, double* transform)\n{\n' % name) + emitter.body(body) + '\n}\n'
+
+
+def jacobian_function(name, chain):
+    emitter = Emitter()
+    _, tip, joints = chain_kinematics(emitter, chain)
+    assignments = []
+    for column, (joint, axis, origin) in enumerate(joints):
+        if joint.type == 'prismatic':
+            rows = axis + [0., 0., 0.]
+        else:
+            lever = [emitter.sum([tip[r], emitter.product(origin[r], -1.)]) for r in range(3)]
+            rows = emitter.cross(axis, lever) + axis
+        for r in range(6):
+            assignments.append('  jacobian[%d] = %s;' % (6 * column + r, expression(rows[r])))
+    return (('inline void %s_jacobian(const double* q, double* jacobian)\n{\n' % name) + emitter.body(assignments) +
+            '\n}\n')
+
+
+def generate(chains):
+    out = ['// Generated by jog_arm/scripts/generate_kinematics.py. Do not edit.',
+           '',
+           '#ifndef JOG_ARM_GENERATED_KINEMATICS_H',
+           '#define JOG_ARM_GENERATED_KINEMATICS_H',
+           '',
+           '#include <cmath>',
+           '#include <jog_arm/support/kinematics_kernel.h>',
+           '',
+           'namespace jog_arm',
+           '{',
+           'namespace generated_kinematics',
+           '{']
+    kernels = []
+    for urdf, base, tip in chains:
+        robot, chain = read_chain(urdf, base, tip)
+        name = identifier('%s_%s_%s' % (robot, base, tip))
+        moving = [joint.name for joint in chain if joint.type != 'fixed']
+        out.append('// %s: %s -> %s' % (robot, base, tip))
+        out.append(forward_function(name, chain))
+        out.append(jacobian_function(name, chain))
+        out.append('const char* const %s_joints[] = { %s };' % (name, ', '.join('"%s"' % j for j in moving)))
+        out.append('')
+        kernels.append('  { "%s", "%s", "%s", %d, %s_joints, &%s_forward, &%s_jacobian },' %
+                       (robot, base, tip, len(moving), name, name, name))
+
+    out.append('// Terminated by an empty entry')
+    out.append('const KinematicsKernel KERNELS[] = {')
+    out.extend(kernels)
+    out.append('  { nullptr, nullptr, nullptr, 0, nullptr, nullptr, nullptr }')
+    out.append('};')
+    out.append('')
+    out.append('}  // namespace generated_kinematics')
+    out.append('}  // namespace jog_arm')
+    out.append('')
+    out.append('#endif  // JOG_ARM_GENERATED_KINEMATICS_H')
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+    parser.add_argument('-o', '--output', required=True, help='header to write')
+    parser.add_argument('chains', nargs='*', help='<urdf>,<base link>,<tip link>')
+    args = parser.parse_args()
+
+    chains = []
+    for chain in args.chains:
+        fields = chain.split(',')
+        if len(fields) != 3:
+            parser.error('expected <urdf>,<base link>,<tip link>, got ' + chain)
+        chains.append(fields)
+
+    try:
+        header = generate(chains)
+    except (IOError, ValueError, ElementTree.ParseError) as error:
+        sys.stderr.write('generate_kinematics.py: %s\n' % error)
+        return 1
+
+    directory = os.path.dirname(args.output)
+    if directory and not os.path.isdir(directory):
+        os.makedirs(directory)
+    with open(args.output, 'w') as output:
+        output.write(header)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -57,8 +57,9 @@ compliance_test::ComplianceClass::ComplianceClass() : spinner_(1), tf_listener_(
   // Listen to the jog_arm warning topic. Exit if the jogger stops
   jog_arm_warning_sub_ = n_.subscribe("jog_arm_server/halted", 1, &ComplianceClass::haltCB, this);
 
-  // Listen to wrench data from a force/torque sensor
-  ft_sub_ = n_.subscribe("left_ur5_wrench", 1, &ComplianceClass::ftCB, this);
+  // Listen to wrench data from a force/torque sensor. Every sample is
+  // filtered, so don't drop any.
+  ft_sub_ = n_.subscribe("left_ur5_wrench", 100, &ComplianceClass::ftCB, this, ros::TransportHints().tcpNoDelay());
 
   // Wait for first ft data to arrive
   ROS_INFO_NAMED("compliance_test", "Waiting for first force/torque data.");
@@ -84,44 +85,35 @@ compliance_test::ComplianceClass::ComplianceClass() : spinner_(1), tf_listener_(
   std::vector<double> endConditionWrench(6, 60.0);
 
   // An object for compliant control
-  compliant_control::CompliantControl comp(stiffness, deadband, endConditionWrench, filterCutoff, ft_data_, 100., 50.);
+  comp_.reset(new compliant_control::CompliantControl(stiffness, deadband, endConditionWrench, filterCutoff, ft_data_,
+                                                      100., 50.));
 
   // The 6 nominal velocity components.
   // For this demo, the robot should be stationary unless a force/torque is
   // applied
-  std::vector<double> vel_nom(6, 0.0);
+  vel_nom_.setZero();
 
   // The 6 velocity feedback components
-  std::vector<double> vel_out(6, 0.0);
-  geometry_msgs::TwistStamped jog_cmd;
-  // Make sure this command frame matches what the jog_arm node expects
-  jog_cmd.header.frame_id = "left_ur5_ee_link";
-
-  // Get initial status
-  ft_data_ = transformToEEF(ft_data_, jog_cmd.header.frame_id);
-  compliantEnum::exitCondition compliance_condition = comp.getVelocity(vel_nom, ft_data_, vel_out);
+  vel_out_.setZero();
 
-  // Loop at X Hz. Specific frequency is not critical
-  ros::Rate rate(100.);
+  // Make sure this command frame matches what the jog_arm node expects
+  jog_cmd_.header.frame_id = "left_ur5_ee_link";
 
-  while (ros::ok() && !jog_is_halted_ && (compliance_condition == compliantEnum::CONDITION_NOT_MET))
-  {
-    ft_data_ = transformToEEF(ft_data_, jog_cmd.header.frame_id);
-    compliance_condition = comp.getVelocity(vel_nom, ft_data_, vel_out);
+  // Refreshed at the cmd rate, outside of ftCB
+  wrench_transformer_.reset(
+      new compliant_control::WrenchTransformer(tf_buffer_, jog_cmd_.header.frame_id, "left_ur5_base", cmd_period_));
 
-    // Send cmds to the robots
-    jog_cmd.header.stamp = ros::Time::now();
-    jog_cmd.twist.linear.x = vel_out[0];
-    jog_cmd.twist.linear.y = vel_out[1];
-    jog_cmd.twist.linear.z = vel_out[2];
-    jog_cmd.twist.angular.x = vel_out[3];
-    jog_cmd.twist.angular.y = vel_out[4];
-    jog_cmd.twist.angular.z = vel_out[5];
+  // From now on ftCB filters every FT sample and sends the cmds
+  compliance_started_ = true;
 
-    vel_pub_.publish(jog_cmd);
+  // The specific frequency of this check is not critical
+  ros::Rate rate(100.);
 
+  while (ros::ok() && !jog_is_halted_ && (compliance_condition_ == compliantEnum::CONDITION_NOT_MET))
     rate.sleep();
-  }
+
+  // No more FT callbacks while comp_ is destroyed
+  spinner_.stop();
 
   if (jog_is_halted_)
     ROS_WARN_NAMED("compliance_test", "Jogging was halted. Singularity, jt "
@@ -139,35 +131,33 @@ void compliance_test::ComplianceClass::ftCB(const geometry_msgs::WrenchStamped::
 {
   ft_data_ = *msg;
   ft_data_.header.frame_id = "left_ur5_base";
-}
 
-// Transform a wrench to the EE frame
-geometry_msgs::WrenchStamped compliance_test::ComplianceClass::transformToEEF(
-    const geometry_msgs::WrenchStamped wrench_in, const std::string desired_ee_frame)
-{
-  geometry_msgs::TransformStamped prev_frame_to_new;
-
-  prev_frame_to_new =
-      tf_buffer_.lookupTransform(desired_ee_frame, wrench_in.header.frame_id, ros::Time(0), ros::Duration(1.0));
-
-  // There is no method to transform a Wrench, so break it into vectors and
-  // transform one at a time
-  geometry_msgs::Vector3Stamped force_vector;
-  force_vector.vector = wrench_in.wrench.force;
-  force_vector.header.frame_id = wrench_in.header.frame_id;
-  tf2::doTransform(force_vector, force_vector, prev_frame_to_new);
-
-  geometry_msgs::Vector3Stamped torque_vector;
-  torque_vector.vector = wrench_in.wrench.torque;
-  torque_vector.header.frame_id = wrench_in.header.frame_id;
-  tf2::doTransform(torque_vector, torque_vector, prev_frame_to_new);
-
-  // Put these components back into a WrenchStamped
-  geometry_msgs::WrenchStamped wrench_out;
-  wrench_out.header.stamp = wrench_in.header.stamp;
-  wrench_out.header.frame_id = desired_ee_frame;
-  wrench_out.wrench.force = force_vector.vector;
-  wrench_out.wrench.torque = torque_vector.vector;
-
-  return wrench_out;
-}
\ No newline at end of file
+  if (!compliance_started_ || compliance_condition_ != compliantEnum::CONDITION_NOT_MET)
+    return;
+
+  // Skip samples until the EE transform is known
+  compliant_control::Vector6d ft_eef;
+  if (!wrench_transformer_->transform(compliant_control::wrenchToVector(ft_data_.wrench), ft_eef))
+    return;
+
+  // Filter and check the exit conditions at the sensor rate
+  compliantEnum::exitCondition condition = comp_->getVelocity(vel_nom_, ft_eef, vel_out_);
+
+  // Send cmds to the robots at the jog rate. A stop goes out at once.
+  const ros::Time now = ros::Time::now();
+  if (condition == compliantEnum::CONDITION_NOT_MET && (now - prev_cmd_time_).toSec() < cmd_period_)
+    return;
+  prev_cmd_time_ = now;
+
+  jog_cmd_.header.stamp = now;
+  jog_cmd_.twist.linear.x = vel_out_[0];
+  jog_cmd_.twist.linear.y = vel_out_[1];
+  jog_cmd_.twist.linear.z = vel_out_[2];
+  jog_cmd_.twist.angular.x = vel_out_[3];
+  jog_cmd_.twist.angular.y = vel_out_[4];
+  jog_cmd_.twist.angular.z = vel_out_[5];
+
+  vel_pub_.publish(jog_cmd_);
+
+  compliance_condition_ = condition;
+}
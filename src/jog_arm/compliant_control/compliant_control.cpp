@@ -3,45 +3,59 @@
 
 namespace compliant_control
 {
+namespace
+{
+// The std::vector API doesn't check sizes. Missing entries are 0.
+Vector6d toVector6d(const std::vector<double>& values)
+{
+  Vector6d result = Vector6d::Zero();
+  for (std::size_t i = 0; i < values.size() && i < compliantEnum::NUM_DIMS; i++)
+    result[i] = values[i];
+  return result;
+}
+}  // namespace
+
+Vector6d wrenchToVector(const geometry_msgs::Wrench& wrench)
+{
+  Vector6d result;
+  result << wrench.force.x, wrench.force.y, wrench.force.z, wrench.torque.x, wrench.torque.y, wrench.torque.z;
+  return result;
+}
+
 CompliantControl::CompliantControl(std::vector<double> stiffness, std::vector<double> deadband,
                                    std::vector<double> endConditionWrench, double filterParam,
                                    geometry_msgs::WrenchStamped bias, double highestAllowableForce,
                                    double highestAllowableTorque)
+  : CompliantControl(toVector6d(stiffness), toVector6d(deadband), toVector6d(endConditionWrench), filterParam,
+                     wrenchToVector(bias.wrench), highestAllowableForce, highestAllowableTorque)
+{
+}
+
+CompliantControl::CompliantControl(const Vector6d& stiffness, const Vector6d& deadband,
+                                   const Vector6d& endConditionWrench, double filterParam, const Vector6d& bias,
+                                   double highestAllowableForce, double highestAllowableTorque)
   : stiffness_(stiffness)
   , deadband_(deadband)
   , end_condition_wrench_(endConditionWrench)
+  , ft_(bias)
+  , bias_(bias)
   , safeForceLimit_(highestAllowableForce)
   , safeTorqueLimit_(highestAllowableTorque)
+  , filters_(compliantEnum::NUM_DIMS, filterParam)
 {
-  bias_.resize(compliantEnum::NUM_DIMS);
-  ft_.resize(compliantEnum::NUM_DIMS);
-
-  for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
-    vectorOfFilters_.push_back(LowPassFilter(filterParam));
-
-  bias_[0] = bias.wrench.force.x;
-  bias_[1] = bias.wrench.force.y;
-  bias_[2] = bias.wrench.force.z;
-  bias_[3] = bias.wrench.torque.x;
-  bias_[4] = bias.wrench.torque.y;
-  bias_[5] = bias.wrench.torque.z;
-  ft_ = bias_;
 }
 
 // Tare or bias the wrench readings -- i.e. reset its ground truth
 void CompliantControl::biasSensor(geometry_msgs::WrenchStamped bias)
 {
-  bias_[0] = bias.wrench.force.x;
-  bias_[1] = bias.wrench.force.y;
-  bias_[2] = bias.wrench.force.z;
-  bias_[3] = bias.wrench.torque.x;
-  bias_[4] = bias.wrench.torque.y;
-  bias_[5] = bias.wrench.torque.z;
+  biasSensor(wrenchToVector(bias.wrench));
+}
 
-  for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
-  {
-    vectorOfFilters_[i].reset(0.);
-  }
+void CompliantControl::biasSensor(const Vector6d& bias)
+{
+  bias_ = bias;
+
+  filters_.reset(0.);
 }
 
 void CompliantControl::setStiffness(std::vector<double> b)
@@ -52,19 +66,24 @@ void CompliantControl::setStiffness(std::vector<double> b)
   }
   else
   {
-    for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
+    setStiffness(toVector6d(b));
+  }
+}
+
+void CompliantControl::setStiffness(const Vector6d& b)
+{
+  for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
+  {
+    if (fabs(b[i]) <= 1e-3)
     {
-      if (fabs(b[i]) <= 1e-3)
-      {
-        ROS_ERROR_STREAM_NAMED("compliant_control", "Stiffness must be non-zero.Ignoring "
-                                                    "Compliance in direction: "
-                                                        << i);
-        stiffness_[i] = DBL_MAX;
-      }
-      else
-      {
-        stiffness_[i] = b[i];
-      }
+      ROS_ERROR_STREAM_NAMED("compliant_control", "Stiffness must be non-zero.Ignoring "
+                                                  "Compliance in direction: "
+                                                      << i);
+      stiffness_[i] = DBL_MAX;
+    }
+    else
+    {
+      stiffness_[i] = b[i];
     }
   }
 }
@@ -77,63 +96,68 @@ void CompliantControl::setEndCondition(std::vector<double> endConditionWrench)
   }
   else
   {
-    for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
-    {
-      end_condition_wrench_[i] = endConditionWrench[i];
-    }
+    setEndCondition(toVector6d(endConditionWrench));
   }
 }
 
+void CompliantControl::setEndCondition(const Vector6d& endConditionWrench)
+{
+  end_condition_wrench_ = endConditionWrench;
+}
+
 void CompliantControl::getFT(geometry_msgs::WrenchStamped ftData)
 {
-  std::vector<double> biasedFT(6, 0.);
+  getFT(wrenchToVector(ftData.wrench));
+}
 
+void CompliantControl::getFT(const Vector6d& ftData)
+{
   // Apply the deadband
-  if (fabs(ftData.wrench.force.x - bias_[0]) < fabs(deadband_[0]))
-    biasedFT[0] = 0.;
-  else
-    biasedFT[0] = ftData.wrench.force.x - bias_[0];
-  if (fabs(ftData.wrench.force.y - bias_[1]) < fabs(deadband_[1]))
-    biasedFT[1] = 0.;
-  else
-    biasedFT[1] = ftData.wrench.force.y - bias_[1];
-  if (fabs(ftData.wrench.force.z - bias_[2]) < fabs(deadband_[2]))
-    biasedFT[2] = 0.;
-  else
-    biasedFT[2] = ftData.wrench.force.z - bias_[2];
+  for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
+  {
+    if (fabs(ftData[i] - bias_[i]) < fabs(deadband_[i]))
+      biased_ft_[i] = 0.;
+    else
+      biased_ft_[i] = ftData[i] - bias_[i];
+  }
 
-  if (fabs(ftData.wrench.torque.x - bias_[3]) < fabs(deadband_[3]))
-    biasedFT[3] = 0.;
-  else
-    biasedFT[3] = ftData.wrench.torque.x - bias_[3];
-  if (fabs(ftData.wrench.torque.y - bias_[4]) < fabs(deadband_[4]))
-    biasedFT[4] = 0.;
-  else
-    biasedFT[4] = ftData.wrench.torque.y - bias_[4];
-  if (fabs(ftData.wrench.torque.z - bias_[5]) < fabs(deadband_[5]))
-    biasedFT[5] = 0.;
-  else
-    biasedFT[5] = ftData.wrench.torque.x - bias_[5];
+  filters_.filter(biased_ft_.data(), ft_.data());
+}
 
-  ft_[0] = vectorOfFilters_[0].filter(biasedFT[0]);
-  ft_[1] = vectorOfFilters_[1].filter(biasedFT[1]);
-  ft_[2] = vectorOfFilters_[2].filter(biasedFT[2]);
-  ft_[3] = vectorOfFilters_[3].filter(biasedFT[3]);
-  ft_[4] = vectorOfFilters_[4].filter(biasedFT[4]);
-  ft_[5] = vectorOfFilters_[5].filter(biasedFT[5]);
+void CompliantControl::getFT(const Vector6d* ftData, std::size_t numSamples)
+{
+  for (std::size_t i = 0; i < numSamples; i++)
+    getFT(ftData[i]);
 }
 
 compliantEnum::exitCondition CompliantControl::getVelocity(std::vector<double> vIn, geometry_msgs::WrenchStamped ftData,
                                                            std::vector<double>& vOut)
 {
-  compliantEnum::exitCondition exitCondition = compliantEnum::NOT_CONTROLLED;
+  Vector6d v_out = toVector6d(vOut);
+  compliantEnum::exitCondition exitCondition = getVelocity(toVector6d(vIn), wrenchToVector(ftData.wrench), v_out);
+
+  vOut.resize(compliantEnum::NUM_DIMS);
+  for (int i = 0; i < compliantEnum::NUM_DIMS; i++)
+    vOut[i] = v_out[i];
+  return exitCondition;
+}
+
+compliantEnum::exitCondition CompliantControl::getVelocity(const Vector6d& vIn, const Vector6d& ftData, Vector6d& vOut)
+{
   getFT(ftData);
+  return getVelocity(vIn, vOut);
+}
+
+compliantEnum::exitCondition CompliantControl::getVelocity(const Vector6d& vIn, Vector6d& vOut)
+{
+  compliantEnum::exitCondition exitCondition = compliantEnum::NOT_CONTROLLED;
 
   if (((fabs(ft_[0]) + fabs(ft_[1]) + fabs(ft_[2])) >= safeForceLimit_) ||
       ((fabs(ft_[3]) + fabs(ft_[4]) + fabs(ft_[5])) >= safeTorqueLimit_))
   {
-    ROS_ERROR_NAMED("compliant_control", "Total force or torque exceeds safety limits. Stopping motion.");
-    vOut = std::vector<double>(6, 0.0);
+    // Called at the sensor rate
+    ROS_ERROR_THROTTLE_NAMED(1, "compliant_control", "Total force or torque exceeds safety limits. Stopping motion.");
+    vOut.setZero();
     return compliantEnum::FT_VIOLATION;
   }
 
@@ -143,7 +167,7 @@ compliantEnum::exitCondition CompliantControl::getVelocity(std::vector<double> v
     {
       if (ft_[i] > end_condition_wrench_[i])
       {
-        ROS_INFO_STREAM_NAMED("compliant_control", "Exit condition met in direction: " << i);
+        ROS_INFO_STREAM_THROTTLE_NAMED(1, "compliant_control", "Exit condition met in direction: " << i);
         vOut[i] = 0.0;
         exitCondition = compliantEnum::CONDITION_MET;
       }
@@ -160,7 +184,7 @@ compliantEnum::exitCondition CompliantControl::getVelocity(std::vector<double> v
     {
       if (ft_[i] < end_condition_wrench_[i])
       {
-        ROS_INFO_STREAM_NAMED("compliant_control", "Exit condition met in direction: " << i);
+        ROS_INFO_STREAM_THROTTLE_NAMED(1, "compliant_control", "Exit condition met in direction: " << i);
         vOut[i] = 0.0;
         exitCondition = compliantEnum::CONDITION_MET;
       }
@@ -177,33 +201,4 @@ compliantEnum::exitCondition CompliantControl::getVelocity(std::vector<double> v
   return exitCondition;
 }
 
-LowPassFilter::LowPassFilter(double filterParam) : filterParam_(filterParam)
-{
-}
-
-double LowPassFilter::filter(const double& new_msrmt)
-{
-  // Push in the new measurement
-  prev_msrmts_[2] = prev_msrmts_[1];
-  prev_msrmts_[1] = prev_msrmts_[0];
-  prev_msrmts_[0] = new_msrmt;
-
-  double new_filtered_msrmt = (1 / (1 + filterParam_ * filterParam_ + 1.414 * filterParam_)) *
-                              (prev_msrmts_[2] + 2 * prev_msrmts_[1] + prev_msrmts_[0] -
-                               (filterParam_ * filterParam_ - 1.414 * filterParam_ + 1) * prev_filtered_msrmts_[1] -
-                               (-2 * filterParam_ * filterParam_ + 2) * prev_filtered_msrmts_[0]);
-  ;
-
-  // Store the new filtered measurement
-  prev_filtered_msrmts_[1] = prev_filtered_msrmts_[0];
-  prev_filtered_msrmts_[0] = new_filtered_msrmt;
-
-  return new_filtered_msrmt;
-}
-
-void LowPassFilter::reset(double data)
-{
-  prev_msrmts_ = { data, data, data };
-  prev_filtered_msrmts_ = { data, data };
-}
-}  // end namespace compliant_control
\ No newline at end of file
+}  // end namespace compliant_control
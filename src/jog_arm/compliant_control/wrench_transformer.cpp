@@ -0,0 +1,114 @@
+#include "jog_arm/compliant_control/wrench_transformer.h"
+
+namespace compliant_control
+{
+WrenchTransformer::WrenchTransformer(tf2_ros::Buffer& tf_buffer, const std::string& target_frame,
+                                     const std::string& source_frame, double refresh_period, WrenchTransformMode mode)
+  : tf_buffer_(tf_buffer)
+  , target_frame_(target_frame)
+  , source_frame_(source_frame)
+  , mode_(mode)
+  , static_frames_(refresh_period <= 0.)
+  , has_transform_(false)
+  , refresh_spinner_(1, &refresh_queue_)
+{
+  // Try once right away
+  if (lookup(adjoint_.writeBuffer()))
+  {
+    adjoint_.publish();
+    if (static_frames_)
+      return;
+  }
+
+  // Until a static transform is found, retry at 10 Hz
+  if (static_frames_)
+    refresh_period = 0.1;
+
+  nh_.setCallbackQueue(&refresh_queue_);
+  refresh_timer_ = nh_.createTimer(ros::Duration(refresh_period), &WrenchTransformer::refresh, this);
+  refresh_spinner_.start();
+}
+
+WrenchTransformer::~WrenchTransformer()
+{
+  refresh_spinner_.stop();
+}
+
+bool WrenchTransformer::transform(const Vector6d& wrench_in, Vector6d& wrench_out)
+{
+  if (adjoint_.update())
+    has_transform_ = true;
+  if (!has_transform_)
+    return false;
+
+  wrench_out.noalias() = adjoint_.get() * wrench_in;
+  return true;
+}
+
+Matrix6d WrenchTransformer::adjoint(const Eigen::Isometry3d& target_from_source)
+{
+  const Eigen::Matrix3d rotation = target_from_source.linear();
+  const Eigen::Vector3d& p = target_from_source.translation();
+
+  Eigen::Matrix3d p_cross;
+  p_cross << 0., -p.z(), p.y(), p.z(), 0., -p.x(), -p.y(), p.x(), 0.;
+
+  Matrix6d result;
+  result.topLeftCorner<3, 3>() = rotation;
+  result.topRightCorner<3, 3>().setZero();
+  result.bottomLeftCorner<3, 3>() = p_cross * rotation;
+  result.bottomRightCorner<3, 3>() = rotation;
+  return result;
+}
+
+Matrix6d WrenchTransformer::rotation(const Eigen::Isometry3d& target_from_source)
+{
+  Matrix6d result = Matrix6d::Zero();
+  result.topLeftCorner<3, 3>() = target_from_source.linear();
+  result.bottomRightCorner<3, 3>() = target_from_source.linear();
+  return result;
+}
+
+// Refresh the cached transform
+void WrenchTransformer::refresh(const ros::TimerEvent&)
+{
+  if (lookup(adjoint_.writeBuffer()))
+  {
+    adjoint_.publish();
+
+    // A static transform won't change
+    if (static_frames_)
+      refresh_timer_.stop();
+  }
+}
+
+bool WrenchTransformer::lookup(Matrix6d& adjoint)
+{
+  geometry_msgs::TransformStamped tf_transform;
+  try
+  {
+    tf_transform = tf_buffer_.lookupTransform(target_frame_, source_frame_, ros::Time(0));
+  }
+  catch (tf2::TransformException& ex)
+  {
+    ROS_WARN_STREAM_THROTTLE_NAMED(2, "compliant_control", "WrenchTransformer: " << ex.what());
+    return false;
+  }
+
+  // Static transforms have no timestamp and won't change
+  if (tf_transform.header.stamp.isZero())
+    static_frames_ = true;
+
+  const geometry_msgs::Quaternion& q = tf_transform.transform.rotation;
+  const geometry_msgs::Vector3& p = tf_transform.transform.translation;
+  Eigen::Isometry3d target_from_source = Eigen::Isometry3d::Identity();
+  target_from_source.linear() = Eigen::Quaterniond(q.w, q.x, q.y, q.z).toRotationMatrix();
+  target_from_source.translation() = Eigen::Vector3d(p.x, p.y, p.z);
+
+  if (mode_ == ROTATION_ONLY)
+    adjoint = WrenchTransformer::rotation(target_from_source);
+  else
+    adjoint = WrenchTransformer::adjoint(target_from_source);
+  return true;
+}
+}  // end namespace compliant_control
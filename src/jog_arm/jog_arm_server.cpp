@@ -34,668 +34,1276 @@
 
 // Server node for arm jogging with MoveIt.
 
+#include <algorithm>
+#include <cstring>
 #include <jog_arm/jog_arm_server.h>
+#include <thread>
 
 /////////////////////////////////////////////////
-// MAIN handles ROS subscriptions.
-// A worker thread does the jogging calculations.
+// The server's callbacks handle ROS subscriptions.
+// Worker threads do the jogging calculations.
 // Another worker thread does collision checking.
+// jog_arm_server_node.cpp and jog_arm_server_nodelet.cpp run the server.
 /////////////////////////////////////////////////
 
-// MAIN: create the worker thread and subscribe to jogging cmds and joint angles
-int main(int argc, char** argv)
+namespace jog_arm
+{
+// A separate thread for the heavy jogging calculations.
+// Runs the calcs of every group assigned to this worker.
+void* joggingPipeline(void* worker_ptr)
 {
-  ros::init(argc, argv, "jog_arm_server");
-  ros::NodeHandle n;
+  JogWorker& worker = *static_cast<JogWorker*>(worker_ptr);
 
-  // Read ROS parameters, typically from YAML file
-  if (jog_arm::readParams(n))
-    return 1;
+  std::vector<std::unique_ptr<JogCalcs> > calcs;
+  for (JogArmGroup* group : worker.groups)
+    calcs.emplace_back(new JogCalcs(worker.nh, *group, worker.kinematic_model, *worker.listener));
 
-  // Crunch the numbers in this thread
-  pthread_t joggingThread;
-  int rc = pthread_create(&joggingThread, NULL, jog_arm::joggingPipeline, 0);
+  ros::Time prev_calc_time(0.);
+  while (ros::ok() && !*worker.stop_requested)
+  {
+    // Sleep until a new command or joint state arrives.
+    // Wake up now and then regardless, to notice shutdown.
+    if (!worker.wakeup.wait(0.1))
+      continue;
+
+    // Don't recalculate more often than the minimum period. Inputs that
+    // arrive meanwhile are picked up by this calculation.
+    Stopwatch throttle_watch;
+    ros::Duration since_prev_calc = ros::Time::now() - prev_calc_time;
+    if (since_prev_calc < ros::Duration(worker.min_calc_period))
+      (ros::Duration(worker.min_calc_period) - since_prev_calc).sleep();
+    prev_calc_time = ros::Time::now();
+    throttle_watch.total(worker.throttle_wait);
+
+    for (std::unique_ptr<JogCalcs>& calc : calcs)
+      calc->update();
+  }
 
-  // Check collisions in this thread
-  pthread_t collisionThread;
-  rc = pthread_create(&collisionThread, NULL, jog_arm::collisionCheck, 0);
+  return nullptr;
+}
+
+// A separate thread for collision checking.
+// One collision world is shared by all groups.
+void* collisionCheck(void* server_ptr)
+{
+  JogArmServer& server = *static_cast<JogArmServer*>(server_ptr);
+
+  std::vector<JogArmGroup*> groups;
+  for (std::unique_ptr<JogArmGroup>& group : server.groups_)
+    if (group->params.coll_check)
+      groups.push_back(group.get());
+
+  jog_arm::CollisionCheck cc(server.nh_, groups, server.collision_joints_, server.kinematic_model_, server.joint_topic_,
+                             server.stop_requested_, server.collision_latency_);
+  return nullptr;
+}
+
+// Create a thread with the given scheduling. Fall back to the default
+// scheduling if that's not permitted.
+static void startThread(pthread_t* thread, const ThreadSettings& settings, void* (*routine)(void*), void* arg)
+{
+  const int error = createThread(thread, settings, routine, arg);
+  if (!error)
+    return;
+
+  ROS_WARN_STREAM_NAMED("jog_arm_server", "Could not apply the realtime thread settings: "
+                                              << strerror(error) << ". Using the default scheduling.");
+  pthread_create(thread, NULL, routine, arg);
+}
+
+JogArmServer::JogArmServer(ros::NodeHandle& n, ros::NodeHandle& private_n)
+  : nh_(n)
+  , private_nh_(private_n)
+  , collision_thread_started_(false)
+  , min_calc_period_(0.)
+  , lock_memory_(false)
+  , diagnostics_period_(0.)
+{
+}
+
+JogArmServer::~JogArmServer()
+{
+  stop();
+}
+
+// Stop and join the threads. A nodelet may be unloaded while ROS keeps running.
+void JogArmServer::stop()
+{
+  stop_requested_ = true;
+
+  for (std::unique_ptr<JogWorker>& worker : workers_)
+  {
+    worker->wakeup.notify();
+    pthread_join(worker->thread, NULL);
+  }
+  workers_.clear();
+
+  if (collision_thread_started_)
+  {
+    pthread_join(collision_thread_, NULL);
+    collision_thread_started_ = false;
+  }
+
+  // The wrench transformers refer to tf2_buffer_
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
+  {
+    group->wrench_sub.shutdown();
+    group->sensor_to_ee_transformer.reset();
+    group->ee_to_cmd_transformer.reset();
+  }
+}
+
+// Read params, load the robot model and start the worker threads
+int JogArmServer::start()
+{
+  ROS_INFO_NAMED("jog_arm_server", "---------------------------------------");
+  ROS_INFO_NAMED("jog_arm_server", " Shared parameters:");
+  ROS_INFO_NAMED("jog_arm_server", "---------------------------------------");
 
-  // ROS subscriptions. Share the data with the worker thread
-  ros::Subscriber cmd_sub = n.subscribe(jog_arm::g_cmd_in_topic, 1, jog_arm::deltaCmdCB);
-  ros::Subscriber joints_sub = n.subscribe(jog_arm::g_joint_topic, 1, jog_arm::jointsCB);
+  // If specified in the launch file, all of the other parameters will be read
+  // from this namespace.
+  std::string parameter_ns;
+  private_nh_.getParam("parameter_ns", parameter_ns);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "Parameter namespace: " << parameter_ns);
+  const std::string shared_ns = parameter_ns + "/jog_arm_server";
+
+  // Params shared by all groups
+  joint_topic_ = get_ros_params::getStringParam(shared_ns + "/joint_topic", nh_);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "joint_topic: " << joint_topic_);
+  min_calc_period_ = get_ros_params::getDoubleParam(shared_ns + "/min_calc_period", nh_);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "min_calc_period: " << min_calc_period_);
+  diagnostics_period_ = get_ros_params::getDoubleParam(shared_ns + "/diagnostics_period", nh_);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "diagnostics_period: " << diagnostics_period_);
+  lock_memory_ = get_ros_params::getBoolParam(shared_ns + "/realtime/lock_memory", nh_);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "realtime/lock_memory: " << lock_memory_);
+  jog_thread_settings_.priority =
+      static_cast<int>(get_ros_params::getIntParam(shared_ns + "/realtime/jog_priority", nh_));
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "realtime/jog_priority: " << jog_thread_settings_.priority);
+  jog_thread_settings_.cpus = get_ros_params::getIntArrayParam(shared_ns + "/realtime/jog_cpus", nh_);
+  collision_thread_settings_.priority =
+      static_cast<int>(get_ros_params::getIntParam(shared_ns + "/realtime/collision_priority", nh_));
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "realtime/collision_priority: " << collision_thread_settings_.priority);
+  collision_thread_settings_.cpus = get_ros_params::getIntArrayParam(shared_ns + "/realtime/collision_cpus", nh_);
+
+  // Optional list of groups. Each entry names a sub-namespace whose params
+  // override the shared ones. Without it, a single group is read from the
+  // shared namespace.
+  std::vector<std::string> group_namespaces;
+  if (!nh_.getParam(shared_ns + "/groups", group_namespaces))
+    group_namespaces.push_back("");
+
+  for (const std::string& group_ns : group_namespaces)
+  {
+    groups_.emplace_back(new JogArmGroup);
+    if (readParams(nh_, shared_ns, group_ns.empty() ? "" : shared_ns + "/" + group_ns, groups_.back()->params))
+      return 1;
+  }
 
-  // Publish freshly-calculated joints to the robot
-  ros::Publisher joint_trajectory_pub = n.advertise<trajectory_msgs::JointTrajectory>(jog_arm::g_cmd_out_topic, 1);
+  // One robot model for all groups
+  model_loader_.reset(new robot_model_loader::RobotModelLoader("robot_description"));
+  kinematic_model_ = model_loader_->getModel();
+  if (!kinematic_model_)
+  {
+    ROS_ERROR_NAMED("jog_arm_server", "Could not load the robot model.");
+    return 1;
+  }
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
+  {
+    if (!kinematic_model_->hasJointModelGroup(group->params.move_group_name))
+    {
+      ROS_ERROR_STREAM_NAMED("jog_arm_server", "Unknown MoveGroup " << group->params.move_group_name);
+      return 1;
+    }
+    if (kinematic_model_->getJointModelGroup(group->params.move_group_name)->getVariableCount() >
+        static_cast<unsigned int>(JacobianSolver::MAX_DOF))
+    {
+      ROS_ERROR_STREAM_NAMED("jog_arm_server", "MoveGroup " << group->params.move_group_name << " has more than "
+                                                            << static_cast<int>(JacobianSolver::MAX_DOF) << " joints.");
+      return 1;
+    }
+  }
 
-  ros::topic::waitForMessage<sensor_msgs::JointState>(jog_arm::g_joint_topic);
-  ros::topic::waitForMessage<geometry_msgs::TwistStamped>(jog_arm::g_cmd_in_topic);
+  listener_.reset(new tf::TransformListener);
 
-  // Wait for jog filters to stablize
-  ros::Duration(10 * jog_arm::g_pub_period).sleep();
+  // In-process compliance. Wrenches are taken about the EE and expressed in the
+  // axes of the cmd frame.
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
+  {
+    const ComplianceParameters& compliance = group->params.compliance;
+    if (!compliance.enable)
+      continue;
+
+    if (!tf2_buffer_)
+    {
+      tf2_buffer_.reset(new tf2_ros::Buffer);
+      tf2_listener_.reset(new tf2_ros::TransformListener(*tf2_buffer_));
+    }
+    group->sensor_to_ee_transformer.reset(new compliant_control::WrenchTransformer(
+        *tf2_buffer_, compliance.ee_frame, compliance.sensor_frame, group->params.pub_period));
+    group->ee_to_cmd_transformer.reset(
+        new compliant_control::WrenchTransformer(*tf2_buffer_, group->params.cmd_frame, compliance.ee_frame,
+                                                 group->params.pub_period, compliant_control::ROTATION_ONLY));
+    group->compliance.reset(new compliant_control::CompliantControl(
+        compliance.stiffness, compliance.deadband, compliance.end_condition_wrench, compliance.filter_coeff,
+        geometry_msgs::WrenchStamped(), compliance.highest_allowable_force, compliance.highest_allowable_torque));
+  }
 
-  ros::Rate main_rate(1. / jog_arm::g_pub_period);
+  // Spread the groups over a pool of worker threads, at most one per core
+  std::size_t num_workers = std::max(1u, std::thread::hardware_concurrency());
+  num_workers = std::min(num_workers, groups_.size());
+  for (std::size_t i = 0; i < num_workers; ++i)
+  {
+    workers_.emplace_back(new JogWorker);
+    workers_.back()->nh = nh_;
+    workers_.back()->kinematic_model = kinematic_model_;
+    workers_.back()->listener = listener_.get();
+    workers_.back()->min_calc_period = min_calc_period_;
+    workers_.back()->stop_requested = &stop_requested_;
+  }
+  for (std::size_t i = 0; i < groups_.size(); ++i)
+  {
+    JogWorker& worker = *workers_[i % num_workers];
+    worker.groups.push_back(groups_[i].get());
+    groups_[i]->calc_wakeup = &worker.wakeup;
+  }
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "Jogging " << groups_.size() << " group(s) on " << num_workers
+                                                     << " worker thread(s).");
+
+  // Deadlines of the latency stats
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
+    group->latencies.total.setDeadline(group->params.pub_period);
+  collision_latency_.setDeadline(0.01);
+  publish_latency_.setDeadline(pubPeriod());
+  publish_interval_.setDeadline(1.5 * pubPeriod());
+
+  // Periodic latency summaries
+  if (diagnostics_period_ > 0.)
+  {
+    diagnostics_pub_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    diagnostics_timer_ =
+        nh_.createTimer(ros::Duration(diagnostics_period_), &JogArmServer::publishDiagnostics, this);
+  }
 
-  while (ros::ok())
+  // ROS subscriptions. Share the data with the worker threads
+  joints_sub_ = nh_.subscribe(joint_topic_, 1, &JogArmServer::jointsCB, this);
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
   {
-    ros::spinOnce();
+    group->cmd_sub = nh_.subscribe(group->params.cmd_in_topic, JogArmGroup::CMD_RING_SIZE, &JogArmGroup::deltaCmdCB,
+                                   group.get());
 
-    // Send the newest target joints
-    pthread_mutex_lock(&jog_arm::g_new_traj_mutex);
-    if (jog_arm::g_new_traj.joint_names.size() != 0)
+    // Every wrench sample is used, so don't drop any
+    if (group->compliance)
+      group->wrench_sub = nh_.subscribe(group->params.compliance.wrench_topic, 100, &JogArmGroup::wrenchCB,
+                                        group.get(), ros::TransportHints().tcpNoDelay());
+
+    // Publish freshly-calculated joints to the robot
+    if (group->params.command_out_type == CMD_OUT_TRAJECTORY)
     {
-      // Check for stale cmds
-      if (ros::Time::now() - jog_arm::g_new_traj.header.stamp < ros::Duration(jog_arm::g_incoming_cmd_timeout))
-      {
-        // Skip the jogging publication if all inputs are 0.
-        pthread_mutex_lock(&jog_arm::g_zero_trajectory_flagmutex);
-        if (!jog_arm::g_zero_trajectory_flag)
-        {
-          jog_arm::g_new_traj.header.stamp = ros::Time::now();
-          joint_trajectory_pub.publish(jog_arm::g_new_traj);
-        }
-        pthread_mutex_unlock(&jog_arm::g_zero_trajectory_flagmutex);
-      }
-      else
-      {
-        ROS_WARN_STREAM_THROTTLE_NAMED(2, "jog_arm_server", "Stale joint "
-                                                            "trajectory msg. Try a larger "
-                                                            "'incoming_cmd_timeout' parameter.");
-        ROS_WARN_STREAM_THROTTLE_NAMED(2, "jog_arm_server", "Did input from the "
-                                                            "controller get interrupted? Are "
-                                                            "calculations taking too long?");
-      }
+      group->cmd_out_pub = nh_.advertise<trajectory_msgs::JointTrajectory>(group->params.cmd_out_topic, 1);
+    }
+    else
+    {
+      group->cmd_out_pub = nh_.advertise<std_msgs::Float64MultiArray>(group->params.cmd_out_topic, 1);
+      group->array_cmd.data.resize(
+          kinematic_model_->getJointModelGroup(group->params.move_group_name)->getVariableCount());
     }
-    pthread_mutex_unlock(&jog_arm::g_new_traj_mutex);
+  }
+
+  // Keep the realtime threads free of page faults
+  if (lock_memory_)
+  {
+    const int error = lockMemory();
+    if (error)
+      ROS_WARN_STREAM_NAMED("jog_arm_server", "Could not lock the memory: " << strerror(error));
+  }
 
-    main_rate.sleep();
+  // Crunch the numbers in these threads. With a list of CPUs, worker i is
+  // pinned to the i-th one.
+  for (std::size_t i = 0; i < workers_.size(); ++i)
+  {
+    ThreadSettings settings = jog_thread_settings_;
+    if (!settings.cpus.empty())
+      settings.cpus.assign(1, jog_thread_settings_.cpus[i % jog_thread_settings_.cpus.size()]);
+    startThread(&workers_[i]->thread, settings, jog_arm::joggingPipeline, workers_[i].get());
+  }
+
+  // Check collisions in this thread
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
+  {
+    if (group->params.coll_check)
+    {
+      startThread(&collision_thread_, collision_thread_settings_, jog_arm::collisionCheck, this);
+      collision_thread_started_ = true;
+      break;
+    }
   }
 
   return 0;
 }
 
-namespace jog_arm
+const std::string& JogArmServer::jointTopic() const
 {
-// A separate thread for the heavy jogging calculations.
-void* joggingPipeline(void*)
+  return joint_topic_;
+}
+
+// The fastest publish period of all groups
+double JogArmServer::pubPeriod() const
 {
-  jog_arm::JogCalcs ja(jog_arm::g_move_group_name);
-  return nullptr;
+  double pub_period = groups_.front()->params.pub_period;
+  for (const std::unique_ptr<JogArmGroup>& group : groups_)
+    pub_period = std::min(pub_period, group->params.pub_period);
+  return pub_period;
 }
 
-// A separate thread for collision checking.
-void* collisionCheck(void*)
+// Publish the first point of a trajectory as an array. A velocity controller
+// keeps moving at its last cmd, so it gets zeros rather than silence when the
+// robot should stop.
+static void publishArray(JogArmGroup& group, const trajectory_msgs::JointTrajectoryPoint& point, bool stop)
 {
-  jog_arm::CollisionCheck cc(jog_arm::g_move_group_name);
-  return nullptr;
+  std::vector<double>& data = group.array_cmd.data;
+  if (group.params.command_out_type == CMD_OUT_VELOCITY_ARRAY)
+  {
+    if (stop)
+      std::fill(data.begin(), data.end(), 0.);
+    else
+      std::copy(point.velocities.begin(), point.velocities.end(), data.begin());
+  }
+  else
+  {
+    if (stop)
+      return;
+    std::copy(point.positions.begin(), point.positions.end(), data.begin());
+  }
+
+  group.cmd_out_pub.publish(group.array_cmd);
 }
 
-// Constructor for the class that handles collision checking
-CollisionCheck::CollisionCheck(const std::string& move_group_name)
+// Publish the newest trajectory of every group
+void JogArmServer::publishTrajectories()
 {
-  // If user specified true in yaml file
-  if (jog_arm::g_coll_check)
+  Stopwatch publish_watch;
+
+  // Time since the previous call. Shows late publication.
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (prev_publish_time_ != std::chrono::steady_clock::time_point())
+    publish_interval_.record(std::chrono::duration<double>(now - prev_publish_time_).count());
+  prev_publish_time_ = now;
+
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
   {
-    // Publish collision status
-    warning_pub_ = nh_.advertise<std_msgs::Bool>(jog_arm::g_warning_topic, 1);
-    std_msgs::Bool collision_status;
-
-    robot_model_loader::RobotModelLoader robot_model_loader("robot_description");
-    const robot_model::RobotModelPtr& kinematic_model = robot_model_loader.getModel();
-    planning_scene::PlanningScene planning_scene(kinematic_model);
-    collision_detection::CollisionRequest collision_request;
-    collision_request.group_name = move_group_name;
-    collision_detection::CollisionResult collision_result;
-    robot_state::RobotState& current_state = planning_scene.getCurrentStateNonConst();
-    moveit::planning_interface::PlanningSceneInterface planning_scene_interface;
-
-    // Wait for initial joint message
-    ROS_INFO_NAMED("jog_arm_server", "Waiting for first joint msg.");
-    ros::topic::waitForMessage<sensor_msgs::JointState>(jog_arm::g_joint_topic);
-    ros::topic::waitForMessage<geometry_msgs::TwistStamped>(jog_arm::g_cmd_in_topic);
-    ROS_INFO_NAMED("jog_arm_server", "Received first joint msg.");
-
-    pthread_mutex_lock(&g_joints_mutex);
-    sensor_msgs::JointState jts = jog_arm::g_joints;
-    pthread_mutex_unlock(&g_joints_mutex);
-
-    ros::Rate collision_rate(100);
-
-    /////////////////////////////////////////////////
-    // Spin while checking collisions
-    /////////////////////////////////////////////////
-    while (ros::ok())
-    {
-      for (std::size_t i = 0; i < jts.position.size(); i++)
-        current_state.setJointPositions(jts.name[i], &jts.position[i]);
+    const bool fresh_traj = group->new_traj.update();
+    trajectory_msgs::JointTrajectoryPtr new_traj = group->new_traj.get();
+    if (!new_traj)
+      continue;
 
-      // process collision objects in scene
-      std::map<std::string, moveit_msgs::CollisionObject> c_objects_map = planning_scene_interface.getObjects();
-      for (auto& kv : c_objects_map)
-      {
-        planning_scene.processCollisionObjectMsg(kv.second);
-      }
+    // The stamp is overwritten at publication. Remember the one of the cmd.
+    if (fresh_traj)
+      group->traj_cmd_stamp = new_traj->header.stamp;
 
-      collision_result.clear();
-      planning_scene.checkCollision(collision_request, collision_result);
+    // Check for stale cmds
+    const bool stale =
+        ros::Time::now() - group->traj_cmd_stamp >= ros::Duration(group->params.incoming_cmd_timeout);
 
-      // If collision, signal the jogging to stop
-      if (collision_result.collision)
-      {
-        pthread_mutex_lock(&jog_arm::g_imminent_collision_mutex);
-        jog_arm::g_imminent_collision = true;
-        pthread_mutex_unlock(&jog_arm::g_imminent_collision_mutex);
+    if (group->params.command_out_type != CMD_OUT_TRAJECTORY)
+      publishArray(*group, new_traj->points[0], stale || group->zero_trajectory_flag);
 
-        collision_status.data = true;
-        warning_pub_.publish(collision_status);
-      }
-      else
+    if (!stale)
+    {
+      // Skip the jogging publication if all inputs are 0.
+      if (group->params.command_out_type == CMD_OUT_TRAJECTORY && !group->zero_trajectory_flag)
       {
-        pthread_mutex_lock(&jog_arm::g_imminent_collision_mutex);
-        jog_arm::g_imminent_collision = false;
-        pthread_mutex_unlock(&jog_arm::g_imminent_collision_mutex);
-      }
+        // A msg that was already published may still be read by subscribers
+        // in this process. Republish a copy rather than changing its stamp.
+        if (!fresh_traj)
+        {
+          if (!group->repeated_traj || group->repeated_traj.use_count() != 1)
+            group->repeated_traj.reset(new trajectory_msgs::JointTrajectory);
+          else
+            std::atomic_thread_fence(std::memory_order_acquire);
+          *group->repeated_traj = *new_traj;
+          new_traj = group->repeated_traj;
+        }
 
-      ros::spinOnce();
-      collision_rate.sleep();
+        new_traj->header.stamp = ros::Time::now();
+        group->cmd_out_pub.publish(new_traj);
+      }
+    }
+    else
+    {
+      ROS_WARN_STREAM_THROTTLE_NAMED(2, "jog_arm_server", "Stale joint "
+                                                          "trajectory msg. Try a larger "
+                                                          "'incoming_cmd_timeout' parameter.");
+      ROS_WARN_STREAM_THROTTLE_NAMED(2, "jog_arm_server", "Did input from the "
+                                                          "controller get interrupted? Are "
+                                                          "calculations taking too long?");
     }
   }
+
+  publish_watch.total(publish_latency_);
 }
 
-// Constructor for the class that handles jogging calculations
-JogCalcs::JogCalcs(const std::string& move_group_name) : arm_(move_group_name), prev_time_(ros::Time::now())
+// Add the summary of one LatencyStats to a diagnostic status
+static void addLatencySummary(const std::string& name, LatencyStats& stats,
+                              diagnostic_msgs::DiagnosticStatus& status)
 {
-  // Publish collision status
-  warning_pub_ = nh_.advertise<std_msgs::Bool>(jog_arm::g_warning_topic, 1);
+  const LatencyStats::Summary summary = stats.takeSummary();
+
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = name + " count";
+  key_value.value = std::to_string(summary.count);
+  status.values.push_back(key_value);
+  key_value.key = name + " p50 [ms]";
+  key_value.value = std::to_string(1e3 * summary.p50);
+  status.values.push_back(key_value);
+  key_value.key = name + " p99 [ms]";
+  key_value.value = std::to_string(1e3 * summary.p99);
+  status.values.push_back(key_value);
+  key_value.key = name + " max [ms]";
+  key_value.value = std::to_string(1e3 * summary.max);
+  status.values.push_back(key_value);
+  key_value.key = name + " deadline misses";
+  key_value.value = std::to_string(summary.deadline_misses);
+  status.values.push_back(key_value);
+
+  if (summary.deadline_misses > 0)
+  {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "Deadline missed";
+  }
+}
 
-  // MoveIt Setup
-  robot_model_loader::RobotModelLoader model_loader("robot_description");
-  const robot_model::RobotModelPtr& kinematic_model = model_loader.getModel();
+// Timer callback. Publish the latency summaries since the previous call.
+void JogArmServer::publishDiagnostics(const ros::TimerEvent&)
+{
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = ros::Time::now();
 
-  kinematic_state_ = std::shared_ptr<robot_state::RobotState>(new robot_state::RobotState(kinematic_model));
-  kinematic_state_->setToDefaultValues();
+  for (std::unique_ptr<JogArmGroup>& group : groups_)
+  {
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "jog_arm_server: " + group->params.move_group_name + " calculations";
+    status.hardware_id = group->params.move_group_name;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "OK";
+
+    JogLatencies& latencies = group->latencies;
+    addLatencySummary("tf conversion", latencies.tf_conversion, status);
+    addLatencySummary("jacobian", latencies.jacobian, status);
+    addLatencySummary("pseudo-inverse", latencies.pseudo_inverse, status);
+    addLatencySummary("filtering", latencies.filtering, status);
+    addLatencySummary("bounds check", latencies.bounds_check, status);
+    addLatencySummary("handoff", latencies.handoff, status);
+    addLatencySummary("total", latencies.total, status);
+    diagnostics.status.push_back(status);
+  }
 
-  joint_model_group_ = kinematic_model->getJointModelGroup(move_group_name);
+  for (std::size_t i = 0; i < workers_.size(); ++i)
+  {
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "jog_arm_server: worker " + std::to_string(i);
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "OK";
+    addLatencySummary("min_calc_period wait", workers_[i]->throttle_wait, status);
+    diagnostics.status.push_back(status);
+  }
 
-  const std::vector<std::string>& joint_names = joint_model_group_->getJointModelNames();
-  std::vector<double> dummy_joint_values;
-  kinematic_state_->copyJointGroupPositions(joint_model_group_, dummy_joint_values);
+  diagnostic_msgs::DiagnosticStatus status;
+  status.name = "jog_arm_server: publication";
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = "OK";
+  addLatencySummary("publish", publish_latency_, status);
+  addLatencySummary("publish interval", publish_interval_, status);
+  diagnostics.status.push_back(status);
 
-  // Wait for initial messages
-  ROS_INFO_NAMED("jog_arm_server", "Waiting for first joint msg.");
-  ros::topic::waitForMessage<sensor_msgs::JointState>(jog_arm::g_joint_topic);
-  ros::topic::waitForMessage<geometry_msgs::TwistStamped>(jog_arm::g_cmd_in_topic);
-  ROS_INFO_NAMED("jog_arm_server", "Received first joint msg.");
+  if (collision_thread_started_)
+  {
+    status = diagnostic_msgs::DiagnosticStatus();
+    status.name = "jog_arm_server: collision check";
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "OK";
+    addLatencySummary("cycle", collision_latency_, status);
+    diagnostics.status.push_back(status);
+  }
 
-  jt_state_.name = arm_.getJointNames();
-  jt_state_.position.resize(jt_state_.name.size());
-  jt_state_.velocity.resize(jt_state_.name.size());
-  jt_state_.effort.resize(jt_state_.name.size());
+  diagnostics_pub_.publish(diagnostics);
+}
+
+// Set the measured joints in a RobotState
+static void setMeasuredJoints(const sensor_msgs::JointState& jts, robot_state::RobotState& state)
+{
+  for (std::size_t i = 0; i < jts.position.size(); i++)
+    state.setJointPositions(jts.name[i], &jts.position[i]);
+}
+
+// Constructor for the class that handles collision checking
+CollisionCheck::CollisionCheck(const ros::NodeHandle& nh, const std::vector<JogArmGroup*>& groups,
+                               TripleBuffer<sensor_msgs::JointState>& joints,
+                               const robot_model::RobotModelConstPtr& kinematic_model, const std::string& joint_topic,
+                               const std::atomic<bool>& stop_requested, LatencyStats& cycle_latency)
+  : nh_(nh), world_version_(0)
+{
+  // Planning scene updates are applied in this thread, from a separate queue
+  nh_.setCallbackQueue(&scene_queue_);
 
-  // Low-pass filters for the joint positions & velocities
-  for (std::size_t i = 0; i < joint_names.size(); i++)
+  std::vector<GroupStatus> statuses(groups.size());
+  for (std::size_t i = 0; i < groups.size(); ++i)
   {
-    velocity_filters_.push_back(jog_arm::LowPassFilter(jog_arm::g_low_pass_filter_coeff));
-    position_filters_.push_back(jog_arm::LowPassFilter(jog_arm::g_low_pass_filter_coeff));
+    statuses[i].group = groups[i];
+    statuses[i].collision_request.group_name = groups[i]->params.move_group_name;
+    statuses[i].measured_collision = false;
+    statuses[i].commanded_collision = false;
+
+    // Publish collision status
+    statuses[i].warning_pub = nh_.advertise<std_msgs::Bool>(groups[i]->params.warning_topic, 1);
   }
+  std_msgs::Bool collision_status;
+  collision_status.data = true;
+  collision_detection::CollisionResult collision_result;
 
-  // Initialize the position filters to initial robot joints
-  pthread_mutex_lock(&g_joints_mutex);
-  incoming_jts_ = jog_arm::g_joints;
-  pthread_mutex_unlock(&g_joints_mutex);
-  updateJoints();
-  for (std::size_t i = 0; i < jt_state_.name.size(); i++)
-    position_filters_[i].reset(jt_state_.position[i]);
+  planning_scene_.reset(new planning_scene::PlanningScene(kinematic_model));
 
-  // Wait for the first jogging cmd.
-  // Store it in a class member for further calcs.
-  // Then free up the shared variable again.
-  while (cmd_deltas_.header.stamp == ros::Time(0.))
+  // Keep a local copy of the world up to date with diffs from move_group.
+  // Subscribe before fetching the full scene so no diff is missed.
+  planning_scene_sub_ =
+      nh_.subscribe("move_group/monitored_planning_scene", 100, &CollisionCheck::planningSceneCB, this);
+  requestPlanningScene();
+
+  // Wait for initial joint message
+  ROS_INFO_NAMED("jog_arm_server", "Waiting for first joint msg.");
+  while (ros::ok() && !stop_requested &&
+         !ros::topic::waitForMessage<sensor_msgs::JointState>(joint_topic, ros::Duration(1.)))
   {
-    ros::Duration(0.05).sleep();
-    pthread_mutex_lock(&g_cmd_deltas_mutex);
-    cmd_deltas_ = jog_arm::g_cmd_deltas;
-    pthread_mutex_unlock(&g_cmd_deltas_mutex);
   }
+  ROS_INFO_NAMED("jog_arm_server", "Received first joint msg.");
+
+  ros::Rate collision_rate(100);
+
+  unsigned int checked_world_version = world_version_ - 1;
 
-  // Now do jogging calcs
-  while (ros::ok())
+  /////////////////////////////////////////////////
+  // Spin while checking collisions
+  /////////////////////////////////////////////////
+  while (ros::ok() && !stop_requested)
   {
-    // If user commands are all zero, reset the low-pass filters
-    // when commands resume
-    pthread_mutex_lock(&jog_arm::g_zero_trajectory_flagmutex);
-    bool flag = jog_arm::g_zero_trajectory_flag;
-    pthread_mutex_unlock(&jog_arm::g_zero_trajectory_flagmutex);
-    if (flag)
-      // Reset low-pass filters
-      resetVelocityFilters();
+    Stopwatch cycle_watch;
 
-    // Pull data from the shared variables.
-    pthread_mutex_lock(&g_cmd_deltas_mutex);
-    cmd_deltas_ = jog_arm::g_cmd_deltas;
-    pthread_mutex_unlock(&g_cmd_deltas_mutex);
+    // Apply any planning scene diffs that arrived
+    scene_queue_.callAvailable();
+    const bool world_changed = (world_version_ != checked_world_version);
+    checked_world_version = world_version_;
 
-    pthread_mutex_lock(&g_joints_mutex);
-    incoming_jts_ = jog_arm::g_joints;
-    pthread_mutex_unlock(&g_joints_mutex);
+    // Only check states that are new, unless the world changed.
+    // Results are reused while nothing changes.
+    const bool check_measured = joints.update() || world_changed;
 
-    updateJoints();
+    // A full scene msg replaces the current state, so don't hold on to it.
+    // The robot state diffs from move_group overwrite its joints, so every
+    // check sets the measured ones first.
+    robot_state::RobotState& current_state = planning_scene_->getCurrentStateNonConst();
+
+    // The measured joints
+    const sensor_msgs::JointState& measured_jts = joints.get();
+    if (measured_jts.name.empty())
+    {
+      collision_rate.sleep();
+      continue;
+    }
+    if (check_measured)
+    {
+      setMeasuredJoints(measured_jts, current_state);
+
+      for (GroupStatus& status : statuses)
+      {
+        collision_result.clear();
+        planning_scene_->checkCollision(status.collision_request, collision_result, current_state);
+        status.measured_collision = collision_result.collision;
+      }
+    }
+
+    // The joints JogCalcs is about to command
+    for (GroupStatus& status : statuses)
+    {
+      const bool check_commanded = status.group->commanded_joints.update() || world_changed;
+      const sensor_msgs::JointState& commanded_jts = status.group->commanded_joints.get();
+      if (check_commanded && !commanded_jts.name.empty())
+      {
+        // The other groups stay at their measured joints
+        setMeasuredJoints(measured_jts, current_state);
+        for (std::size_t i = 0; i < commanded_jts.position.size(); i++)
+          current_state.setJointPositions(commanded_jts.name[i], &commanded_jts.position[i]);
+
+        collision_result.clear();
+        planning_scene_->checkCollision(status.collision_request, collision_result, current_state);
+        status.commanded_collision = collision_result.collision;
+      }
+    }
 
-    jogCalcs(cmd_deltas_);
+    // If collision, signal the jogging to stop
+    for (GroupStatus& status : statuses)
+    {
+      if (status.measured_collision || status.commanded_collision)
+      {
+        status.group->imminent_collision = true;
+        status.warning_pub.publish(collision_status);
+      }
+      else
+      {
+        status.group->imminent_collision = false;
+      }
+    }
 
-    // Generally want to run these calculations fast.
-    // Add a small sleep to avoid 100% CPU usage
-    ros::Duration(0.001).sleep();
+    cycle_watch.total(cycle_latency);
+    collision_rate.sleep();
   }
 }
 
-// Perform the jogging calculations
-void JogCalcs::jogCalcs(const geometry_msgs::TwistStamped& cmd)
+// Fetch the whole planning scene from move_group once, at startup
+void CollisionCheck::requestPlanningScene()
 {
-  // Convert the cmd to the MoveGroup planning frame.
-  try
+  ros::ServiceClient client = nh_.serviceClient<moveit_msgs::GetPlanningScene>("get_planning_scene");
+  if (!client.waitForExistence(ros::Duration(5.)))
   {
-    listener_.waitForTransform(cmd.header.frame_id, jog_arm::g_planning_frame, ros::Time::now(), ros::Duration(0.2));
-  }
-  catch (tf::TransformException ex)
-  {
-    ROS_ERROR_STREAM_NAMED("jog_arm_server", "jogCalcs: " << ex.what());
+    ROS_WARN_NAMED("jog_arm_server", "The get_planning_scene service is not available. Starting with an empty world.");
     return;
   }
-  // To transform, these vectors need to be stamped. See answers.ros.org
-  // Q#199376
-  // Transform the linear component of the cmd message
-  geometry_msgs::Vector3Stamped lin_vector;
-  lin_vector.vector = cmd.twist.linear;
-  lin_vector.header.frame_id = cmd.header.frame_id;
-  try
-  {
-    listener_.transformVector(jog_arm::g_planning_frame, lin_vector, lin_vector);
-  }
-  catch (tf::TransformException ex)
+
+  moveit_msgs::GetPlanningScene srv;
+  srv.request.components.components =
+      moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_NAMES |
+      moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY | moveit_msgs::PlanningSceneComponents::OCTOMAP |
+      moveit_msgs::PlanningSceneComponents::TRANSFORMS |
+      moveit_msgs::PlanningSceneComponents::ALLOWED_COLLISION_MATRIX |
+      moveit_msgs::PlanningSceneComponents::LINK_PADDING_AND_SCALING |
+      moveit_msgs::PlanningSceneComponents::ROBOT_STATE_ATTACHED_OBJECTS;
+  if (!client.call(srv))
   {
-    ROS_ERROR_STREAM_NAMED("jog_arm_server", ex.what());
+    ROS_WARN_NAMED("jog_arm_server", "Failed to get the planning scene. Starting with an empty world.");
     return;
   }
 
-  geometry_msgs::Vector3Stamped rot_vector;
-  rot_vector.vector = cmd.twist.angular;
-  rot_vector.header.frame_id = cmd.header.frame_id;
-  try
+  // Apply it on top of the empty world. Joint values are set by this thread.
+  srv.response.scene.is_diff = true;
+  srv.response.scene.robot_state.is_diff = true;
+  planning_scene_->usePlanningSceneMsg(srv.response.scene);
+  ++world_version_;
+}
+
+// True if the msg may change what the robot can collide with. move_group
+// keeps sending diffs with only the robot state, even while the arm is idle.
+static bool changesCollisionGeometry(const moveit_msgs::PlanningScene& scene)
+{
+  return !scene.is_diff || !scene.world.collision_objects.empty() || !scene.world.octomap.octomap.data.empty() ||
+         !scene.allowed_collision_matrix.entry_names.empty() || !scene.link_padding.empty() ||
+         !scene.link_scale.empty() || !scene.robot_state.attached_collision_objects.empty();
+}
+
+// Apply a planning scene update from move_group
+void CollisionCheck::planningSceneCB(const moveit_msgs::PlanningSceneConstPtr& msg)
+{
+  planning_scene_->usePlanningSceneMsg(*msg);
+  if (changesCollisionGeometry(*msg))
+    ++world_version_;
+}
+
+// Constructor for the class that handles jogging calculations
+JogCalcs::JogCalcs(const ros::NodeHandle& nh, JogArmGroup& group,
+                   const robot_model::RobotModelConstPtr& kinematic_model, tf::TransformListener& listener)
+  : nh_(nh)
+  , group_(group)
+  , params_(group.params)
+  , core_(kinematic_model, group.params)
+  , listener_(listener)
+  , prev_time_(ros::Time::now())
+{
+  // Input frame determined by YAML file
+  cmd_deltas_.header.frame_id = params_.cmd_frame;
+
+  // Publish collision status
+  warning_pub_ = nh_.advertise<std_msgs::Bool>(params_.warning_topic, 1);
+
+  core_.setLatencyStats(&group_.latencies);
+
+  jt_state_.name = core_.jointNames();
+  jt_state_.position.resize(jt_state_.name.size());
+
+  // Outgoing msgs. One is being filled, one waits in the new_traj channel and
+  // one is held by main. Spares cover msgs still queued in the publisher.
+  for (std::size_t i = 0; i < 5; i++)
+    traj_pool_.push_back(allocateTrajectory());
+
+  // Cache the transform from the command frame to the planning frame. If TF
+  // doesn't have it yet, update() retries. Waiting here would block the worker,
+  // and with it the other groups and stop().
+  resolveCmdFrame();
+}
+
+// Cache the cmd_frame --> planning_frame transform for the first time
+bool JogCalcs::resolveCmdFrame()
+{
+  Eigen::Isometry3d& cmd_frame_transform = cmd_frame_transform_.writeBuffer();
+  if (!lookupCmdFrameTransform(cmd_frame_transform))
+    return false;
+  cmd_frame_transform_.publish();
+  cmd_frame_resolved_ = true;
+
+  // Static transforms have no timestamp. Only a frame known to be static is
+  // never refreshed. If TF can't tell, assume the frame moves.
+  ros::Time common_time;
+  const int error = listener_.getLatestCommonTime(params_.planning_frame, params_.cmd_frame, common_time, nullptr);
+  if (error != tf::NO_ERROR || !common_time.isZero())
+    cmd_frame_timer_ = nh_.createTimer(ros::Duration(params_.pub_period), &JogCalcs::updateCmdFrameTransform, this);
+  return true;
+}
+
+// Process the new cmds and the newest joints
+void JogCalcs::update()
+{
+  // Pull data from the shared variables.
+  const bool new_cmd = drainCmds();
+  const bool new_joints = group_.joints.update();
+  if (!new_cmd && !new_joints)
+    return;
+
+  if (new_joints)
+    incoming_jts_ = group_.joints.get();
+
+  // Wait for the first joint msg
+  if (incoming_jts_.name.empty())
+    return;
+
+  if (!updateJoints())
+    return;
+
+  // Initialize the position filters to initial robot joints
+  if (!position_filters_initialized_)
   {
-    listener_.transformVector(jog_arm::g_planning_frame, rot_vector, rot_vector);
+    core_.resetPositionFilters(jt_state_.position);
+    position_filters_initialized_ = true;
   }
-  catch (tf::TransformException ex)
-  {
-    ROS_ERROR_STREAM_NAMED("jog_arm_server", ex.what());
+
+  // Wait for the first jogging cmd.
+  if (cmd_deltas_.header.stamp == ros::Time(0.))
     return;
-  }
 
-  // Put these components back into a TwistStamped
-  geometry_msgs::TwistStamped twist_cmd;
-  twist_cmd.header.stamp = cmd.header.stamp;
-  twist_cmd.header.frame_id = jog_arm::g_planning_frame;
-  twist_cmd.twist.linear = lin_vector.vector;
-  twist_cmd.twist.angular = rot_vector.vector;
-
-  // Apply user-defined scaling
-  const Vector6d delta_x = scaleCommand(twist_cmd);
-
-  kinematic_state_->setVariableValues(jt_state_);
-  orig_jts_ = jt_state_;
-
-  // Convert from cartesian commands to joint commands
-  Eigen::MatrixXd jacobian = kinematic_state_->getJacobian(joint_model_group_);
-  Eigen::VectorXd delta_theta = pseudoInverse(jacobian) * delta_x;
-
-  // This inner loop may execute slower or faster than the desired rate. Scale
-  // these joint
-  // commands to match the desired rate. Then the velocity will match the user's
-  // expectations.
-  delta_t_ = (ros::Time::now() - prev_time_).toSec();
-  prev_time_ = ros::Time::now();
-  delta_theta(0) *= jog_arm::g_pub_period / delta_t_;
-  delta_theta(1) *= jog_arm::g_pub_period / delta_t_;
-  delta_theta(2) *= jog_arm::g_pub_period / delta_t_;
-  delta_theta(3) *= jog_arm::g_pub_period / delta_t_;
-  delta_theta(4) *= jog_arm::g_pub_period / delta_t_;
-  delta_theta(5) *= jog_arm::g_pub_period / delta_t_;
-
-  if (!addJointIncrements(jt_state_, delta_theta))
+  // Wait for the cmd frame in TF
+  if (!cmd_frame_resolved_ && !resolveCmdFrame())
     return;
 
-  // Check the Jacobian with these new joints.
-  kinematic_state_->setVariableValues(jt_state_);
-  jacobian = kinematic_state_->getJacobian(joint_model_group_);
+  // If user commands are all zero, reset the low-pass filters
+  // when commands resume
+  if (group_.zero_trajectory_flag)
+    // Reset low-pass filters
+    core_.resetVelocityFilters();
 
-  // Include a velocity estimate for velocity-controller robots
-  Eigen::VectorXd joint_vel(delta_theta / delta_t_);
+  jogCalcs(cmd_deltas_);
+}
 
-  // Low-pass filter the velocities
-  for (std::size_t i = 0; i < jt_state_.name.size(); i++)
+// Combine the cmds that arrived since the previous cycle
+bool JogCalcs::drainCmds()
+{
+  TimedTwist cmd;
+  if (!group_.cmd_ring.pop(cmd))
+    return false;
+
+  // Both sums are kept. The weighted one falls back to the mean if the cmds
+  // carry no usable stamps.
+  Vector6d sum = Vector6d::Zero();
+  Vector6d weighted_sum = Vector6d::Zero();
+  double count = 0., total_weight = 0.;
+  do
   {
-    joint_vel[static_cast<long>(i)] = velocity_filters_[i].filter(joint_vel[static_cast<long>(i)]);
+    const Eigen::Map<const Vector6d> twist(cmd.twist);
+    sum += twist;
+    count += 1.;
 
-    // Check for nan's
-    if (std::isnan(joint_vel[static_cast<long>(i)]))
-      joint_vel[static_cast<long>(i)] = 0.;
-  }
-  updateJointVels(jt_state_, joint_vel);
+    // Each cmd stands for the motion since the one before it. After a pause,
+    // for at most one publish period.
+    if (!prev_cmd_stamp_.isZero() && cmd.stamp > prev_cmd_stamp_)
+    {
+      const double weight = std::min((cmd.stamp - prev_cmd_stamp_).toSec(), params_.pub_period);
+      weighted_sum += weight * twist;
+      total_weight += weight;
+    }
+    prev_cmd_stamp_ = cmd.stamp;
+  } while (group_.cmd_ring.pop(cmd));
+
+  // cmd holds the newest one
+  Vector6d combined = Eigen::Map<const Vector6d>(cmd.twist);
+  if (params_.cmd_coalescing == COALESCE_INTEGRATE && total_weight > 0.)
+    combined = weighted_sum / total_weight;
+  else if (params_.cmd_coalescing != COALESCE_LATEST)
+    combined = sum / count;
+
+  cmd_deltas_.header.stamp = cmd.stamp;
+  cmd_deltas_.twist.linear.x = combined[0];
+  cmd_deltas_.twist.linear.y = combined[1];
+  cmd_deltas_.twist.linear.z = combined[2];
+  cmd_deltas_.twist.angular.x = combined[3];
+  cmd_deltas_.twist.angular.y = combined[4];
+  cmd_deltas_.twist.angular.z = combined[5];
+  return true;
+}
 
-  // Low-pass filter the positions
-  for (std::size_t i = 0; i < jt_state_.name.size(); i++)
+// Perform the jogging calculations
+void JogCalcs::jogCalcs(const geometry_msgs::TwistStamped& cmd)
+{
+  JogLatencies& latencies = group_.latencies;
+  Stopwatch watch;
+
+  Vector6d twist;
+  twist << cmd.twist.linear.x, cmd.twist.linear.y, cmd.twist.linear.z, cmd.twist.angular.x, cmd.twist.angular.y,
+      cmd.twist.angular.z;
+
+  // Convert the cmd to the MoveGroup planning frame, using the cached transform
+  cmd_frame_transform_.update();
+  const Eigen::Matrix3d rotation = cmd_frame_transform_.get().linear();
+  twist.head<3>() = rotation * twist.head<3>();
+  twist.tail<3>() = rotation * twist.tail<3>();
+  watch.lap(latencies.tf_conversion);
+
+  // This inner loop may execute slower or faster than the desired rate.
+  // JogCore scales the joint commands to match the desired rate.
+  const ros::Time now = ros::Time::now();
+  const double delta_t = (now - prev_time_).toSec();
+  prev_time_ = now;
+
+  const unsigned int status = core_.jog(twist, jt_state_.position, delta_t, group_.imminent_collision);
+  if (status & JOG_INVALID_INPUT)
   {
-    jt_state_.position[i] = position_filters_[i].filter(jt_state_.position[i]);
-
-    // Check for nan's
-    if (std::isnan(jt_state_.position[i]))
-      jt_state_.position[i] = 0.;
+    ROS_ERROR_NAMED("jog_arm_server", "Number of joints does not match "
+                                      "the MoveGroup.");
+    return;
   }
 
-  // Compose the outgoing msg
-  trajectory_msgs::JointTrajectory new_jt_traj;
-  new_jt_traj.header.frame_id = jog_arm::g_planning_frame;
-  new_jt_traj.header.stamp = cmd.header.stamp;
-  new_jt_traj.joint_names = jt_state_.name;
-  trajectory_msgs::JointTrajectoryPoint point;
-  point.positions = jt_state_.position;
-  point.time_from_start = ros::Duration(jog_arm::g_pub_period);
-  point.velocities = jt_state_.velocity;
-
-  new_jt_traj.points.push_back(point);
+  // Resume the stage timing after the numeric stages recorded by JogCore
+  Stopwatch handoff_watch;
 
-  // Stop if imminent collision
-  pthread_mutex_lock(&jog_arm::g_imminent_collision_mutex);
-  bool collision = jog_arm::g_imminent_collision;
-  pthread_mutex_unlock(&jog_arm::g_imminent_collision_mutex);
-  if (collision)
-  {
+  if (status & JOG_HALT_COLLISION)
     ROS_ERROR_THROTTLE_NAMED(2, "jog_arm_server", "Close to a collision. Halting.");
 
-    halt(new_jt_traj);
-  }
-
-  // Verify that the future Jacobian is well-conditioned before moving.
-  // Slow down if very close to a singularity.
-  // Stop if extremely close.
-  double current_condition_number = checkConditionNumber(jacobian);
-  if (current_condition_number > jog_arm::g_singularity_threshold)
+  if (status & JOG_HALT_SINGULARITY)
   {
-    if (current_condition_number > jog_arm::g_hard_stop_sing_thresh)
-    {
-      ROS_ERROR_THROTTLE_NAMED(2, "jog_arm_server", "Close to a "
-                                                    "singularity (%f). Halting.",
-                               current_condition_number);
-
-      halt(new_jt_traj);
+    ROS_ERROR_THROTTLE_NAMED(2, "jog_arm_server", "Close to a "
+                                                  "singularity (%f). Halting.",
+                             core_.conditionNumber());
 
-      std_msgs::Bool singularity_status;
-      singularity_status.data = true;
-      warning_pub_.publish(singularity_status);
-    }
-    // Only somewhat close to singularity. Just slow down.
-    else
-    {
-      for (std::size_t i = 0; i < jt_state_.velocity.size(); i++)
-      {
-        new_jt_traj.points[0].positions[i] =
-            new_jt_traj.points[0].positions[i] - 0.7 * delta_theta[static_cast<long>(i)];
-        new_jt_traj.points[0].velocities[i] *= 0.3;
-      }
-    }
+    std_msgs::Bool singularity_status;
+    singularity_status.data = true;
+    warning_pub_.publish(singularity_status);
   }
 
-  // Check if new joints would be within bounds
-  if (!kinematic_state_->satisfiesBounds(joint_model_group_))
+  if (status & JOG_HALT_BOUNDS)
   {
     ROS_ERROR_THROTTLE_NAMED(2, "jog_arm_server", "Close to a "
                                                   "position or velocity limit. Halting.");
 
-    halt(new_jt_traj);
-
     std_msgs::Bool limit_status;
     limit_status.data = true;
     warning_pub_.publish(limit_status);
   }
 
-  if (jog_arm::g_simu)
-    // Spam several redundant points into the trajectory. The first few may be
-    // skipped if the
-    // time stamp is in the past when it reaches the client. Needed for gazebo
-    // simulation.
-    // Start from 2 because the first point's timestamp is already
-    // 1*jog_arm::g_pub_period
-    point = new_jt_traj.points[0];
-  for (int i = 2; i < 30; i++)
+  // Compose the outgoing msg in a reused buffer. Only the stamp and the
+  // joint values change from cycle to cycle.
+  const trajectory_msgs::JointTrajectoryPtr new_jt_traj_ptr = acquireTrajectory();
+  trajectory_msgs::JointTrajectory& new_jt_traj = *new_jt_traj_ptr;
+  new_jt_traj.header.stamp = cmd.header.stamp;
+
+  // The first point is the cmd. The lookahead points continue it at the
+  // filtered velocities, so the controller keeps moving smoothly if a cycle is
+  // late or dropped, and a point that is already in the past when it reaches
+  // the client can be skipped.
+  const std::vector<double>& positions = core_.positions();
+  const std::vector<double>& velocities = core_.velocities();
+  for (std::size_t i = 0; i < new_jt_traj.points.size(); i++)
   {
-    point.time_from_start = ros::Duration(i * jog_arm::g_pub_period);
-    new_jt_traj.points.push_back(point);
+    core_.extrapolate(i * params_.pub_period, new_jt_traj.points[i].positions);
+    std::copy(velocities.begin(), velocities.end(), new_jt_traj.points[i].velocities.begin());
   }
 
   // Share with main to be published
-  pthread_mutex_lock(&jog_arm::g_new_traj_mutex);
-  jog_arm::g_new_traj = new_jt_traj;
-  pthread_mutex_unlock(&jog_arm::g_new_traj_mutex);
+  group_.new_traj.write(new_jt_traj_ptr);
+
+  // Share the commanded joints with the collision check
+  if (params_.coll_check)
+  {
+    sensor_msgs::JointState& commanded_jts = group_.commanded_joints.writeBuffer();
+    commanded_jts.name = new_jt_traj.joint_names;
+    commanded_jts.position = positions;
+    group_.commanded_joints.publish();
+  }
+  handoff_watch.lap(latencies.handoff);
+  watch.total(latencies.total);
 }
 
-// Halt the robot
-void JogCalcs::halt(trajectory_msgs::JointTrajectory& jt_traj)
+// Look up the latest cmd_frame --> planning_frame transform without waiting
+bool JogCalcs::lookupCmdFrameTransform(Eigen::Isometry3d& transform)
 {
-  for (std::size_t i = 0; i < jt_state_.velocity.size(); i++)
+  tf::StampedTransform tf_transform;
+  try
   {
-    jt_traj.points[0].positions[i] = orig_jts_.position[i];
-    jt_traj.points[0].velocities[i] = 0.;
+    listener_.lookupTransform(params_.planning_frame, params_.cmd_frame, ros::Time(0), tf_transform);
   }
-  // Store all zeros in the velocity filter
-  resetVelocityFilters();
+  catch (tf::TransformException ex)
+  {
+    ROS_WARN_STREAM_THROTTLE_NAMED(2, "jog_arm_server", "lookupCmdFrameTransform: " << ex.what());
+    return false;
+  }
+
+  const tf::Quaternion& q = tf_transform.getRotation();
+  const tf::Vector3& p = tf_transform.getOrigin();
+  transform.setIdentity();
+  transform.linear() = Eigen::Quaterniond(q.w(), q.x(), q.y(), q.z()).toRotationMatrix();
+  transform.translation() = Eigen::Vector3d(p.x(), p.y(), p.z());
+
+  return true;
 }
 
-// Reset the data stored in filters so the trajectory won't jump when jogging is
-// resumed.
-void JogCalcs::resetVelocityFilters()
+// Refresh the cached transform of a moving cmd_frame. Keep the old one if TF
+// has nothing newer.
+void JogCalcs::updateCmdFrameTransform(const ros::TimerEvent&)
 {
-  for (std::size_t i = 0; i < jt_state_.name.size(); i++)
-    velocity_filters_[i].reset(0);  // Zero velocity
+  if (lookupCmdFrameTransform(cmd_frame_transform_.writeBuffer()))
+    cmd_frame_transform_.publish();
 }
 
-// Update joint velocities
-bool JogCalcs::updateJointVels(sensor_msgs::JointState& output, const Eigen::VectorXd& joint_vels) const
+// An outgoing msg that nobody else holds, with the layout of this MoveGroup
+trajectory_msgs::JointTrajectoryPtr JogCalcs::acquireTrajectory()
 {
-  for (std::size_t i = 0, size = static_cast<std::size_t>(joint_vels.size()); i < size; ++i)
+  for (std::size_t i = 0; i < traj_pool_.size(); i++)
   {
-    try
+    // The pool's reference is the only one left once the msg has been
+    // published and replaced in the new_traj channel
+    if (traj_pool_[i].use_count() == 1)
     {
-      output.velocity[i] = joint_vels(static_cast<long>(i));
-    }
-    catch (std::out_of_range e)
-    {
-      ROS_ERROR_NAMED("jog_arm_server", "Vector lengths do not match.");
-      return false;
+      // Make the other threads' last accesses visible before reusing the msg
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return traj_pool_[i];
     }
   }
 
-  return true;
+  // All msgs are in flight. Grow the pool.
+  traj_pool_.push_back(allocateTrajectory());
+  return traj_pool_.back();
 }
 
-// Parse the incoming joint msg for the joints of our MoveGroup
-void JogCalcs::updateJoints()
+// Allocate an outgoing msg. Everything but the stamp and the joint values is
+// filled here, once.
+trajectory_msgs::JointTrajectoryPtr JogCalcs::allocateTrajectory() const
 {
-  // Check that the msg contains enough joints
-  if (incoming_jts_.name.size() < jt_state_.name.size())
-  {
-    ROS_WARN_NAMED("JogCalcs", "The joint msg does not contain enough "
-                               "joints.");
-    return;
-  }
+  trajectory_msgs::JointTrajectoryPtr traj(new trajectory_msgs::JointTrajectory);
+  traj->header.frame_id = params_.planning_frame;
+  traj->joint_names = jt_state_.name;
 
-  // Store joints in a member variable
-  for (std::size_t m = 0; m < incoming_jts_.name.size(); m++)
+  // The first point plus the lookahead points, see jogCalcs()
+  traj->points.resize(1 + static_cast<std::size_t>(params_.lookahead_points));
+  for (std::size_t i = 0; i < traj->points.size(); i++)
   {
-    for (std::size_t c = 0; c < jt_state_.name.size(); c++)
-    {
-      if (incoming_jts_.name[m] == jt_state_.name[c])
-      {
-        jt_state_.position[c] = incoming_jts_.position[m];
-        goto NEXT_JOINT;
-      }
-    }
-  NEXT_JOINT:;
+    traj->points[i].positions.resize(jt_state_.name.size());
+    traj->points[i].velocities.resize(jt_state_.name.size());
+    traj->points[i].time_from_start = ros::Duration((i + 1) * params_.pub_period);
   }
+
+  return traj;
 }
 
-// Scale the incoming jog command
-JogCalcs::Vector6d JogCalcs::scaleCommand(const geometry_msgs::TwistStamped& command) const
+// Parse the incoming joint msg for the joints of our MoveGroup
+bool JogCalcs::updateJoints()
 {
-  Vector6d result;
+  // The index map only changes when the joint msg layout does
+  if (!jointIndexMapValid() && !updateJointIndexMap())
+  {
+    ROS_WARN_THROTTLE_NAMED(2, "JogCalcs", "The joint msg does not contain all "
+                                           "joints of the MoveGroup.");
+    return false;
+  }
 
-  result(0) = jog_arm::g_linear_scale * command.twist.linear.x;
-  result(1) = jog_arm::g_linear_scale * command.twist.linear.y;
-  result(2) = jog_arm::g_linear_scale * command.twist.linear.z;
-  result(3) = jog_arm::g_rot_scale * command.twist.angular.x;
-  result(4) = jog_arm::g_rot_scale * command.twist.angular.y;
-  result(5) = jog_arm::g_rot_scale * command.twist.angular.z;
+  // Store joints in a member variable
+  for (std::size_t c = 0; c < joint_index_map_.size(); c++)
+    jt_state_.position[c] = incoming_jts_.position[joint_index_map_[c]];
 
-  return result;
+  return true;
 }
 
-// Calculate a pseudo-inverse.
-Eigen::MatrixXd JogCalcs::pseudoInverse(const Eigen::MatrixXd& J) const
+// Check that the joints of our MoveGroup are still where the map says they are
+bool JogCalcs::jointIndexMapValid() const
 {
-  Eigen::MatrixXd transpose = J.transpose();
-  return transpose * (J * transpose).inverse();
+  if (joint_index_map_.empty() || incoming_jts_.name.size() != incoming_layout_size_ ||
+      incoming_jts_.position.size() != incoming_layout_size_)
+    return false;
+
+  for (std::size_t c = 0; c < joint_index_map_.size(); c++)
+    if (incoming_jts_.name[joint_index_map_[c]] != jt_state_.name[c])
+      return false;
+
+  return true;
 }
 
-// Add the deltas to each joint
-bool JogCalcs::addJointIncrements(sensor_msgs::JointState& output, const Eigen::VectorXd& increments) const
+// Find the joints of our MoveGroup in the incoming joint msg
+bool JogCalcs::updateJointIndexMap()
 {
-  for (std::size_t i = 0, size = static_cast<std::size_t>(increments.size()); i < size; ++i)
+  joint_index_map_.clear();
+  incoming_layout_size_ = 0;
+
+  if (incoming_jts_.position.size() != incoming_jts_.name.size())
+    return false;
+
+  std::vector<std::size_t> index_map(jt_state_.name.size());
+  for (std::size_t c = 0; c < jt_state_.name.size(); c++)
   {
-    try
-    {
-      output.position[i] += increments(static_cast<long>(i));
-    }
-    catch (std::out_of_range e)
-    {
-      ROS_ERROR_NAMED("jog_arm_server", "Lengths of output and "
-                                        "increments do not match.");
+    std::vector<std::string>::const_iterator it =
+        std::find(incoming_jts_.name.begin(), incoming_jts_.name.end(), jt_state_.name[c]);
+    if (it == incoming_jts_.name.end())
       return false;
-    }
+    index_map[c] = static_cast<std::size_t>(it - incoming_jts_.name.begin());
   }
 
+  joint_index_map_.swap(index_map);
+  incoming_layout_size_ = incoming_jts_.name.size();
   return true;
 }
 
-/// Calculate the condition number of the jacobian, to check for singularities
-double JogCalcs::checkConditionNumber(const Eigen::MatrixXd& matrix) const
+// Listen to cartesian delta commands.
+// Queue them for the jogger.
+void JogArmGroup::deltaCmdCB(const geometry_msgs::TwistStampedConstPtr& msg)
 {
-  // Get Eigenvalues
-  Eigen::MatrixXd::EigenvaluesReturnType eigs = matrix.eigenvalues();
-  Eigen::VectorXd eig_vector = eigs.cwiseAbs();
+  // With compliance, the cmds are the nominal velocity. wrenchCB feeds the
+  // jogger.
+  if (compliance)
+  {
+    nominal_cmd.write(*msg);
+    return;
+  }
 
-  // CN = max(eigs)/min(eigs)
-  double min = eig_vector.minCoeff();
-  double max = eig_vector.maxCoeff();
+  TimedTwist cmd;
+  cmd.stamp = msg->header.stamp;
+  cmd.twist[0] = msg->twist.linear.x;
+  cmd.twist[1] = msg->twist.linear.y;
+  cmd.twist[2] = msg->twist.linear.z;
+  cmd.twist[3] = msg->twist.angular.x;
+  cmd.twist[4] = msg->twist.angular.y;
+  cmd.twist[5] = msg->twist.angular.z;
 
-  double condition_number = max / min;
+  // Check if input is all zeros. Flag it if so to skip calculations/publication
+  zero_trajectory_flag = (cmd.twist[0] == 0 && cmd.twist[1] == 0 && cmd.twist[2] == 0 && cmd.twist[3] == 0 &&
+                          cmd.twist[4] == 0 && cmd.twist[5] == 0);
 
-  return condition_number;
+  if (!cmd_ring.push(cmd))
+    ROS_WARN_THROTTLE_NAMED(1, "jog_arm_server", "The jogger is falling behind. Dropping cmds.");
+  calc_wakeup->notify();
 }
 
-// Listen to cartesian delta commands.
-// Store them in a shared variable.
-void deltaCmdCB(const geometry_msgs::TwistStampedConstPtr& msg)
+// Listen to force/torque data.
+// Turn every sample into a cmd and hand it straight to the jogger.
+void JogArmGroup::wrenchCB(const geometry_msgs::WrenchStampedConstPtr& msg)
 {
-  pthread_mutex_lock(&g_cmd_deltas_mutex);
-  jog_arm::g_cmd_deltas = *msg;
-  // Input frame determined by YAML file:
-  jog_arm::g_cmd_deltas.header.frame_id = jog_arm::g_cmd_frame;
-  pthread_mutex_unlock(&g_cmd_deltas_mutex);
+  // Tare with the first sample. The offset is the sensor's own, so it is
+  // removed before the wrench is rotated into the cmd frame.
+  const compliant_control::Vector6d sensor_wrench = compliant_control::wrenchToVector(msg->wrench);
+  if (!compliance_biased)
+  {
+    compliance_bias = sensor_wrench;
+    compliance_biased = true;
+    return;
+  }
 
-  // Check if input is all zeros. Flag it if so to skip calculations/publication
-  pthread_mutex_lock(&jog_arm::g_zero_trajectory_flagmutex);
-  if (jog_arm::g_cmd_deltas.twist.linear.x == 0 && jog_arm::g_cmd_deltas.twist.linear.y == 0 &&
-      jog_arm::g_cmd_deltas.twist.linear.z == 0 && jog_arm::g_cmd_deltas.twist.angular.x == 0 &&
-      jog_arm::g_cmd_deltas.twist.linear.y == 0 && jog_arm::g_cmd_deltas.twist.linear.z == 0)
-    jog_arm::g_zero_trajectory_flag = true;
-  else
-    jog_arm::g_zero_trajectory_flag = false;
-  pthread_mutex_unlock(&jog_arm::g_zero_trajectory_flagmutex);
+  // A contact force at the EE must not become a torque about a distant cmd
+  // frame origin, so only the axes change after the EE
+  compliant_control::Vector6d ee_wrench, wrench;
+  if (!sensor_to_ee_transformer->transform(sensor_wrench - compliance_bias, ee_wrench) ||
+      !ee_to_cmd_transformer->transform(ee_wrench, wrench))
+    return;
+
+  // The nominal velocity stops when the cmds do
+  const ros::Time now = ros::Time::now();
+  nominal_cmd.update();
+  const geometry_msgs::TwistStamped& nominal = nominal_cmd.get();
+  compliant_control::Vector6d velocity_in = compliant_control::Vector6d::Zero();
+  if (now - nominal.header.stamp < ros::Duration(params.incoming_cmd_timeout))
+    velocity_in << nominal.twist.linear.x, nominal.twist.linear.y, nominal.twist.linear.z, nominal.twist.angular.x,
+        nominal.twist.angular.y, nominal.twist.angular.z;
+
+  // Dimensions that met their end condition, or all of them on a force/torque
+  // violation, are zeroed
+  compliant_control::Vector6d velocity_out;
+  compliance->getVelocity(velocity_in, wrench, velocity_out);
+
+  TimedTwist cmd;
+  cmd.stamp = now;
+  Eigen::Map<compliant_control::Vector6d>(cmd.twist) = velocity_out;
+
+  zero_trajectory_flag = (velocity_out.array() == 0.).all();
+
+  if (!cmd_ring.push(cmd))
+    ROS_WARN_THROTTLE_NAMED(1, "jog_arm_server", "The jogger is falling behind. Dropping cmds.");
+  calc_wakeup->notify();
 }
 
 // Listen to joint angles.
-// Store them in a shared variable.
-void jointsCB(const sensor_msgs::JointStateConstPtr& msg)
+// Store them in the shared variables of every group.
+void JogArmServer::jointsCB(const sensor_msgs::JointStateConstPtr& msg)
+{
+  for (std::size_t i = 0; i < groups_.size(); ++i)
+    groups_[i]->joints.write(*msg);
+  collision_joints_.write(*msg);
+
+  for (std::size_t i = 0; i < workers_.size(); ++i)
+    workers_[i]->wakeup.notify();
+}
+
+// Pick the group-specific param if there is one, otherwise the shared param
+static std::string paramName(ros::NodeHandle& n, const std::string& shared_ns, const std::string& group_ns,
+                             const std::string& name)
 {
-  pthread_mutex_lock(&g_joints_mutex);
-  jog_arm::g_joints = *msg;
-  pthread_mutex_unlock(&g_joints_mutex);
+  if (!group_ns.empty() && n.hasParam(group_ns + "/" + name))
+    return group_ns + "/" + name;
+  return shared_ns + "/" + name;
 }
 
 // Read ROS parameters, typically from YAML file
-int readParams(ros::NodeHandle& n)
+int readParams(ros::NodeHandle& n, const std::string& shared_ns, const std::string& group_ns,
+               JogArmParameters& params)
 {
   ROS_INFO_NAMED("jog_arm_server", "---------------------------------------");
-  ROS_INFO_NAMED("jog_arm_server", " Parameters:");
+  ROS_INFO_STREAM_NAMED("jog_arm_server", " Parameters: " << (group_ns.empty() ? shared_ns : group_ns));
   ROS_INFO_NAMED("jog_arm_server", "---------------------------------------");
 
-  // If specified in the launch file, all of the other parameters will be read
-  // from this namespace.
-  std::string parameter_ns;
-  ros::param::get("~parameter_ns", parameter_ns);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "Parameter namespace: " << parameter_ns);
-
-  jog_arm::g_move_group_name = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/move_group_name", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "move_group_name: " << jog_arm::g_move_group_name);
-  jog_arm::g_linear_scale = get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/scale/linear", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "linear_scale: " << jog_arm::g_linear_scale);
-  jog_arm::g_rot_scale = get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/scale/rotational", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "rot_scale: " << jog_arm::g_rot_scale);
-  jog_arm::g_low_pass_filter_coeff =
-      get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/low_pass_filter_coeff", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "low_pass_filter_coeff: " << jog_arm::g_low_pass_filter_coeff);
-  jog_arm::g_joint_topic = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/joint_topic", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "joint_topic: " << jog_arm::g_joint_topic);
-  jog_arm::g_cmd_in_topic = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/cmd_in_topic", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_in_topic: " << jog_arm::g_cmd_in_topic);
-  jog_arm::g_cmd_frame = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/cmd_frame", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_frame: " << jog_arm::g_cmd_frame);
-  jog_arm::g_incoming_cmd_timeout =
-      get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/incoming_cmd_timeout", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "incoming_cmd_timeout: " << jog_arm::g_incoming_cmd_timeout);
-  jog_arm::g_cmd_out_topic = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/cmd_out_topic", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_out_topic: " << jog_arm::g_cmd_out_topic);
-  jog_arm::g_singularity_threshold =
-      get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/singularity_threshold", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "singularity_threshold: " << jog_arm::g_singularity_threshold);
-  jog_arm::g_hard_stop_sing_thresh =
-      get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/hard_stop_singularity_threshold", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "hard_stop_singularity_threshold: " << jog_arm::g_hard_stop_sing_thresh);
-  jog_arm::g_planning_frame = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/planning_frame", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "planning_frame: " << jog_arm::g_planning_frame);
-  jog_arm::g_pub_period = get_ros_params::getDoubleParam(parameter_ns + "/jog_arm_server/pub_period", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "pub_period: " << jog_arm::g_pub_period);
-  jog_arm::g_simu = get_ros_params::getBoolParam(parameter_ns + "/jog_arm_server/simu", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "simu: " << jog_arm::g_simu);
-  jog_arm::g_coll_check = get_ros_params::getBoolParam(parameter_ns + "/jog_arm_server/coll_check", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "coll_check: " << jog_arm::g_coll_check);
-  jog_arm::g_warning_topic = get_ros_params::getStringParam(parameter_ns + "/jog_arm_server/warning_topic", n);
-  ROS_INFO_STREAM_NAMED("jog_arm_server", "warning_topic: " << jog_arm::g_warning_topic);
+  params.move_group_name = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "move_group_name"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "move_group_name: " << params.move_group_name);
+  params.linear_scale = get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "scale/linear"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "linear_scale: " << params.linear_scale);
+  params.rot_scale = get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "scale/rotational"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "rot_scale: " << params.rot_scale);
+  params.low_pass_filter_coeff =
+      get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "low_pass_filter_coeff"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "low_pass_filter_coeff: " << params.low_pass_filter_coeff);
+  params.cmd_in_topic = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "cmd_in_topic"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_in_topic: " << params.cmd_in_topic);
+  params.cmd_frame = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "cmd_frame"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_frame: " << params.cmd_frame);
+  params.incoming_cmd_timeout =
+      get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "incoming_cmd_timeout"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "incoming_cmd_timeout: " << params.incoming_cmd_timeout);
+  params.cmd_out_topic = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "cmd_out_topic"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_out_topic: " << params.cmd_out_topic);
+  params.singularity_threshold =
+      get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "singularity_threshold"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "singularity_threshold: " << params.singularity_threshold);
+  params.hard_stop_sing_thresh =
+      get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "hard_stop_singularity_threshold"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "hard_stop_singularity_threshold: " << params.hard_stop_sing_thresh);
+  params.planning_frame = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "planning_frame"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "planning_frame: " << params.planning_frame);
+  params.singularity_damping =
+      get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "singularity_damping"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "singularity_damping: " << params.singularity_damping);
+  params.pub_period = get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "pub_period"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "pub_period: " << params.pub_period);
+  params.lookahead_points =
+      static_cast<int>(get_ros_params::getIntParam(paramName(n, shared_ns, group_ns, "lookahead_points"), n));
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "lookahead_points: " << params.lookahead_points);
+  const std::string cmd_coalescing =
+      get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "cmd_coalescing"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "cmd_coalescing: " << cmd_coalescing);
+  const std::string command_out_type =
+      get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "command_out_type"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "command_out_type: " << command_out_type);
+  if (n.hasParam(paramName(n, shared_ns, group_ns, "simu")))
+    ROS_WARN_NAMED("jog_arm_server", "Parameter 'simu' no longer has any effect. Trajectories always carry "
+                                     "'lookahead_points' extrapolated points.");
+  params.coll_check = get_ros_params::getBoolParam(paramName(n, shared_ns, group_ns, "coll_check"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "coll_check: " << params.coll_check);
+  params.warning_topic = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "warning_topic"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "warning_topic: " << params.warning_topic);
+  ComplianceParameters& compliance = params.compliance;
+  compliance.enable = get_ros_params::getBoolParam(paramName(n, shared_ns, group_ns, "compliance/enable"), n);
+  ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/enable: " << compliance.enable);
+  if (compliance.enable)
+  {
+    compliance.wrench_topic =
+        get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "compliance/wrench_topic"), n);
+    ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/wrench_topic: " << compliance.wrench_topic);
+    compliance.sensor_frame =
+        get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "compliance/sensor_frame"), n);
+    ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/sensor_frame: " << compliance.sensor_frame);
+    compliance.ee_frame = get_ros_params::getStringParam(paramName(n, shared_ns, group_ns, "compliance/ee_frame"), n);
+    ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/ee_frame: " << compliance.ee_frame);
+    compliance.stiffness =
+        get_ros_params::getDoubleArrayParam(paramName(n, shared_ns, group_ns, "compliance/stiffness"), n);
+    compliance.deadband =
+        get_ros_params::getDoubleArrayParam(paramName(n, shared_ns, group_ns, "compliance/deadband"), n);
+    compliance.end_condition_wrench =
+        get_ros_params::getDoubleArrayParam(paramName(n, shared_ns, group_ns, "compliance/end_condition_wrench"), n);
+    compliance.filter_coeff =
+        get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "compliance/filter_coeff"), n);
+    ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/filter_coeff: " << compliance.filter_coeff);
+    compliance.highest_allowable_force =
+        get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "compliance/highest_allowable_force"), n);
+    ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/highest_allowable_force: "
+                                                << compliance.highest_allowable_force);
+    compliance.highest_allowable_torque =
+        get_ros_params::getDoubleParam(paramName(n, shared_ns, group_ns, "compliance/highest_allowable_torque"), n);
+    ROS_INFO_STREAM_NAMED("jog_arm_server", "compliance/highest_allowable_torque: "
+                                                << compliance.highest_allowable_torque);
+  }
   ROS_INFO_NAMED("jog_arm_server", "---------------------------------------");
   ROS_INFO_NAMED("jog_arm_server", "---------------------------------------");
 
   // Input checking
-  if (jog_arm::g_hard_stop_sing_thresh < jog_arm::g_singularity_threshold)
+  if (params.hard_stop_sing_thresh < params.singularity_threshold)
   {
     ROS_WARN_NAMED("jog_arm_server", "Parameter 'hard_stop_sing_thresh' "
                                      "should be greater than 'singularity_threshold.'");
     return 1;
   }
-  if ((jog_arm::g_hard_stop_sing_thresh < 0.) || (jog_arm::g_singularity_threshold < 0.))
+  if ((params.hard_stop_sing_thresh < 0.) || (params.singularity_threshold < 0.))
   {
     ROS_WARN_NAMED("jog_arm_server", "Parameters 'hard_stop_sing_thresh' "
                                      "and 'singularity_threshold' should be greater than zero.");
     return 1;
   }
+  if (params.singularity_damping < 0.)
+  {
+    ROS_WARN_NAMED("jog_arm_server", "Parameter 'singularity_damping' should not be negative.");
+    return 1;
+  }
+  if (command_out_type == "trajectory")
+    params.command_out_type = CMD_OUT_TRAJECTORY;
+  else if (command_out_type == "position_array")
+    params.command_out_type = CMD_OUT_POSITION_ARRAY;
+  else if (command_out_type == "velocity_array")
+    params.command_out_type = CMD_OUT_VELOCITY_ARRAY;
+  else
+  {
+    ROS_WARN_NAMED("jog_arm_server", "Parameter 'command_out_type' should be 'trajectory', 'position_array' or "
+                                     "'velocity_array'.");
+    return 1;
+  }
+  if (cmd_coalescing == "latest")
+    params.cmd_coalescing = COALESCE_LATEST;
+  else if (cmd_coalescing == "average")
+    params.cmd_coalescing = COALESCE_AVERAGE;
+  else if (cmd_coalescing == "integrate")
+    params.cmd_coalescing = COALESCE_INTEGRATE;
+  else
+  {
+    ROS_WARN_NAMED("jog_arm_server", "Parameter 'cmd_coalescing' should be 'latest', 'average' or 'integrate'.");
+    return 1;
+  }
+  if (params.lookahead_points < 0)
+  {
+    ROS_WARN_NAMED("jog_arm_server", "Parameter 'lookahead_points' should not be negative.");
+    return 1;
+  }
+  if (compliance.enable && (compliance.stiffness.size() != compliantEnum::NUM_DIMS ||
+                            compliance.deadband.size() != compliantEnum::NUM_DIMS ||
+                            compliance.end_condition_wrench.size() != compliantEnum::NUM_DIMS))
+  {
+    ROS_WARN_NAMED("jog_arm_server", "Parameters 'compliance/stiffness', 'compliance/deadband' and "
+                                     "'compliance/end_condition_wrench' need 6 entries.");
+    return 1;
+  }
 
   return 0;
 }
-}  // namespace jog_arm
\ No newline at end of file
+
+}  // namespace jog_arm
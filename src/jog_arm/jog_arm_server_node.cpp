@@ -0,0 +1,39 @@
+// Run the jog_arm server in its own node.
+
+#include <jog_arm/jog_arm_server.h>
+
+// MAIN: start the server and publish its trajectories
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "jog_arm_server");
+  ros::NodeHandle n;
+  ros::NodeHandle private_n("~");
+
+  jog_arm::JogArmServer server(n, private_n);
+
+  // Dispatch the callbacks as msgs arrive, like the multi-threaded handles of
+  // the nodelet. The loop below only publishes. Declared after the server, so
+  // it stops before the server is destroyed.
+  ros::AsyncSpinner spinner(0);
+  spinner.start();
+
+  if (server.start())
+    return 1;
+
+  ros::topic::waitForMessage<sensor_msgs::JointState>(server.jointTopic());
+
+  // Wait for jog filters to stablize
+  ros::Duration(10 * server.pubPeriod()).sleep();
+
+  ros::Rate main_rate(1. / server.pubPeriod());
+
+  while (ros::ok())
+  {
+    // Send the newest target joints
+    server.publishTrajectories();
+
+    main_rate.sleep();
+  }
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+// Run the jog_arm server as a nodelet. Loaded into the same manager as the
+// robot driver and the cmd source, msgs are passed without serialization.
+
+#include <jog_arm/jog_arm_server.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+namespace jog_arm
+{
+/**
+ * Class JogArmServerNodelet - Owns a JogArmServer and publishes its
+ * trajectories from a timer.
+ */
+class JogArmServerNodelet : public nodelet::Nodelet
+{
+public:
+  ~JogArmServerNodelet()
+  {
+    publish_timer_.stop();
+    server_.reset();
+  }
+
+private:
+  void onInit() override
+  {
+    server_.reset(new JogArmServer(getMTNodeHandle(), getMTPrivateNodeHandle()));
+    if (server_->start())
+    {
+      NODELET_ERROR("Could not start the jog_arm server.");
+      server_.reset();
+      return;
+    }
+
+    // Nothing is published before the first jogging cmd, so there's no need
+    // to block the manager while waiting for joints
+    publish_timer_ = getMTNodeHandle().createTimer(ros::Duration(server_->pubPeriod()),
+                                                   &JogArmServerNodelet::publishCB, this);
+  }
+
+  // Send the newest target joints
+  void publishCB(const ros::TimerEvent&)
+  {
+    server_->publishTrajectories();
+  }
+
+  std::unique_ptr<JogArmServer> server_;
+
+  ros::Timer publish_timer_;
+};
+
+}  // namespace jog_arm
+
+PLUGINLIB_EXPORT_CLASS(jog_arm::JogArmServerNodelet, nodelet::Nodelet)
@@ -0,0 +1,203 @@
+#include "jog_arm/jog_core.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace jog_arm
+{
+JogCore::JogCore(const robot_model::RobotModelConstPtr& kinematic_model, const JogCoreParameters& params)
+  : params_(params)
+  , kernel_(nullptr)
+  , velocity_filters_(0, params.low_pass_filter_coeff)
+  , position_filters_(0, params.low_pass_filter_coeff)
+  , latencies_(nullptr)
+{
+  joint_model_group_ = kinematic_model->getJointModelGroup(params_.move_group_name);
+  if (!joint_model_group_)
+    throw std::invalid_argument("Unknown MoveGroup " + params_.move_group_name);
+  if (joint_model_group_->getVariableCount() > static_cast<unsigned int>(JacobianSolver::MAX_DOF))
+    throw std::invalid_argument("Too many joints in MoveGroup " + params_.move_group_name);
+
+  try
+  {
+    chain_.reset(new ChainKinematics(joint_model_group_));
+    kernel_ = findKinematicsKernel(joint_model_group_, *chain_);
+  }
+  catch (const std::invalid_argument&)
+  {
+    kinematic_state_.reset(new robot_state::RobotState(kinematic_model));
+    kinematic_state_->setToDefaultValues();
+  }
+
+  jacobian_solver_.setDamping(params_.singularity_damping);
+
+  // Size the workspace once. Later calcs only resize within these bounds.
+  const int num_joints = static_cast<int>(joint_model_group_->getVariableCount());
+  moveit_jacobian_.resize(6, num_joints);
+  jacobian_.resize(6, num_joints);
+  delta_theta_.resize(num_joints);
+  joint_vel_.resize(num_joints);
+
+  positions_.resize(static_cast<std::size_t>(num_joints));
+  velocities_.resize(static_cast<std::size_t>(num_joints));
+
+  velocity_filters_ = FilterBank(num_joints, params_.low_pass_filter_coeff);
+  position_filters_ = FilterBank(num_joints, params_.low_pass_filter_coeff);
+}
+
+const std::vector<std::string>& JogCore::jointNames() const
+{
+  return joint_model_group_->getVariableNames();
+}
+
+void JogCore::resetPositionFilters(const std::vector<double>& positions)
+{
+  if (positions.size() == positions_.size())
+    position_filters_.reset(positions.data());
+}
+
+void JogCore::resetVelocityFilters()
+{
+  velocity_filters_.reset(0.);  // Zero velocity
+}
+
+unsigned int JogCore::jog(const Vector6d& twist, const std::vector<double>& positions, double delta_t,
+                          bool imminent_collision)
+{
+  if (positions.size() != positions_.size())
+    return JOG_INVALID_INPUT;
+
+  Stopwatch watch;
+  unsigned int status = JOG_OK;
+
+  // Apply user-defined scaling
+  Vector6d delta_x;
+  delta_x.head<3>() = params_.linear_scale * twist.head<3>();
+  delta_x.tail<3>() = params_.rot_scale * twist.tail<3>();
+
+  // Convert from cartesian commands to joint commands
+  updateJacobian(positions);
+  if (latencies_)
+    watch.lap(latencies_->jacobian);
+  jacobian_solver_.compute(jacobian_);
+  jacobian_solver_.solve(delta_x, delta_theta_);
+  if (latencies_)
+    watch.lap(latencies_->pseudo_inverse);
+
+  // This inner loop may execute slower or faster than the desired rate. Scale
+  // these joint commands to match the desired rate. Then the velocity will
+  // match the user's expectations.
+  delta_theta_ *= params_.pub_period / delta_t;
+
+  // Add the deltas to each joint
+  for (std::size_t i = 0; i < positions_.size(); i++)
+    positions_[i] = positions[i] + delta_theta_[static_cast<long>(i)];
+
+  // For the bounds check. The group's own bounds, without a RobotState.
+  const bool within_bounds = joint_model_group_->satisfiesPositionBounds(positions_.data());
+
+  // Include a velocity estimate for velocity-controller robots
+  joint_vel_ = delta_theta_ / delta_t;
+
+  // Low-pass filter the velocities and positions
+  velocity_filters_.filter(joint_vel_.data(), velocities_.data());
+  position_filters_.filter(positions_.data(), positions_.data());
+
+  // Check for nan's
+  for (std::size_t i = 0; i < positions_.size(); i++)
+  {
+    if (std::isnan(velocities_[i]))
+      velocities_[i] = 0.;
+    if (std::isnan(positions_[i]))
+      positions_[i] = 0.;
+  }
+  if (latencies_)
+    watch.lap(latencies_->filtering);
+
+  // Stop if imminent collision
+  if (imminent_collision)
+  {
+    halt(positions);
+    status |= JOG_HALT_COLLISION;
+  }
+
+  // Verify that the Jacobian is well-conditioned before moving.
+  // Slow down if very close to a singularity.
+  // Stop if extremely close.
+  const double current_condition_number = jacobian_solver_.conditionNumber();
+  if (current_condition_number > params_.singularity_threshold)
+  {
+    if (current_condition_number > params_.hard_stop_sing_thresh)
+    {
+      halt(positions);
+      status |= JOG_HALT_SINGULARITY;
+    }
+    // Only somewhat close to singularity. Just slow down.
+    else
+    {
+      for (std::size_t i = 0; i < positions_.size(); i++)
+      {
+        positions_[i] -= 0.7 * delta_theta_[static_cast<long>(i)];
+        velocities_[i] *= 0.3;
+      }
+      status |= JOG_NEAR_SINGULARITY;
+    }
+  }
+
+  // Check if new joints would be within bounds
+  if (!within_bounds)
+  {
+    halt(positions);
+    status |= JOG_HALT_BOUNDS;
+  }
+  if (latencies_)
+    watch.lap(latencies_->bounds_check);
+
+  return status;
+}
+
+// Fill jacobian_ for these joints.
+// A generated kernel is straight-line code for one arm. The chain only
+// recomputes the links after the first joint that moved. For other groups,
+// MoveIt only provides a dynamically-sized Jacobian. moveit_jacobian_ keeps the
+// same size every cycle, so it is filled without reallocating.
+void JogCore::updateJacobian(const std::vector<double>& positions)
+{
+  if (kernel_)
+  {
+    kernel_->jacobian(positions.data(), jacobian_.data());
+    return;
+  }
+  if (chain_)
+  {
+    chain_->update(positions.data());
+    chain_->jacobian(jacobian_);
+    return;
+  }
+
+  kinematic_state_->setJointGroupPositions(joint_model_group_, positions.data());
+  kinematic_state_->getJacobian(joint_model_group_, joint_model_group_->getLinkModels().back(),
+                                Eigen::Vector3d::Zero(), moveit_jacobian_);
+  jacobian_ = moveit_jacobian_;
+}
+
+void JogCore::extrapolate(double time, std::vector<double>& positions) const
+{
+  for (std::size_t i = 0; i < positions_.size(); i++)
+    positions[i] = positions_[i] + velocities_[i] * time;
+  joint_model_group_->enforcePositionBounds(positions.data());
+}
+
+// Halt the robot
+void JogCore::halt(const std::vector<double>& measured_positions)
+{
+  for (std::size_t i = 0; i < positions_.size(); i++)
+  {
+    positions_[i] = measured_positions[i];
+    velocities_[i] = 0.;
+  }
+  // Store all zeros in the velocity filter
+  resetVelocityFilters();
+}
+
+}  // namespace jog_arm
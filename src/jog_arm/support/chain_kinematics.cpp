@@ -0,0 +1,152 @@
+#include "jog_arm/support/chain_kinematics.h"
+
+#include <moveit/robot_model/prismatic_joint_model.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <stdexcept>
+
+namespace jog_arm
+{
+// The fixed transform from a joint's parent link to its frame. Converted via
+// the matrix because older MoveIt versions return an Affine3d.
+static Eigen::Isometry3d jointOrigin(const robot_model::JointModel* joint)
+{
+  return Eigen::Isometry3d(joint->getChildLinkModel()->getJointOriginTransform().matrix());
+}
+
+ChainKinematics::ChainKinematics(const robot_model::JointModelGroup* joint_model_group)
+  : tip_offset_(Eigen::Isometry3d::Identity()), tip_transform_(Eigen::Isometry3d::Identity()), initialized_(false)
+{
+  const std::string& group_name = joint_model_group->getName();
+  if (joint_model_group->getLinkModels().empty())
+    throw std::invalid_argument("MoveGroup " + group_name + " has no links");
+
+  const unsigned int num_variables = joint_model_group->getVariableCount();
+  if (num_variables > static_cast<unsigned int>(JacobianSolver::MAX_DOF))
+    throw std::invalid_argument("Too many joints in MoveGroup " + group_name);
+
+  // Walk from the tip up to the root, until every variable of the group is
+  // found. Fixed joints are accumulated into the offset of the next moving
+  // joint below them.
+  const robot_model::LinkModel* link = joint_model_group->getLinkModels().back();
+  tip_link_name_ = link->getName();
+  Eigen::Isometry3d below = Eigen::Isometry3d::Identity();
+  std::vector<Segment, Eigen::aligned_allocator<Segment> > reversed;
+  while (reversed.size() < num_variables)
+  {
+    const robot_model::JointModel* joint = link->getParentJointModel();
+    if (!joint || !joint->getParentLinkModel())
+      throw std::invalid_argument("MoveGroup " + group_name + " is not a serial chain");
+
+    if (joint->getType() == robot_model::JointModel::FIXED)
+    {
+      below = jointOrigin(joint) * below;
+    }
+    else
+    {
+      if (!joint_model_group->hasJointModel(joint->getName()) || joint->getMimic() ||
+          joint->getVariableCount() != 1 ||
+          (joint->getType() != robot_model::JointModel::REVOLUTE &&
+           joint->getType() != robot_model::JointModel::PRISMATIC))
+        throw std::invalid_argument("MoveGroup " + group_name +
+                                    " is not a serial chain of revolute and prismatic joints");
+
+      // Everything below this joint until the previous moving one
+      if (reversed.empty())
+        tip_offset_ = below;
+      else
+        reversed.back().offset = below;
+      below = jointOrigin(joint);
+
+      Segment segment;
+      segment.prismatic = joint->getType() == robot_model::JointModel::PRISMATIC;
+      if (segment.prismatic)
+        segment.axis = static_cast<const robot_model::PrismaticJointModel*>(joint)->getAxis();
+      else
+        segment.axis = static_cast<const robot_model::RevoluteJointModel*>(joint)->getAxis();
+      segment.variable_index = joint_model_group->getVariableGroupIndex(joint->getName());
+      reversed.push_back(segment);
+    }
+    link = joint->getParentLinkModel();
+  }
+  if (reversed.empty())
+    throw std::invalid_argument("MoveGroup " + group_name + " has no joints");
+
+  // MoveIt's reference frame is the parent of the group's first joint, which
+  // may be a fixed one
+  while (link->getParentJointModel() && link->getParentJointModel()->getParentLinkModel() &&
+         link->getParentJointModel()->getType() == robot_model::JointModel::FIXED &&
+         joint_model_group->hasJointModel(link->getParentJointModel()->getName()))
+  {
+    below = jointOrigin(link->getParentJointModel()) * below;
+    link = link->getParentJointModel()->getParentLinkModel();
+  }
+
+  // The first joint's offset is relative to the root link
+  reversed.back().offset = below;
+  root_link_name_ = link->getName();
+
+  segments_.assign(reversed.rbegin(), reversed.rend());
+  joint_frames_.resize(segments_.size());
+  moved_frames_.resize(segments_.size());
+  positions_.resize(static_cast<long>(segments_.size()));
+}
+
+std::size_t ChainKinematics::update(const double* positions)
+{
+  // Everything before the first changed joint is still valid
+  std::size_t first = 0;
+  if (initialized_)
+  {
+    while (first < segments_.size() &&
+           positions[segments_[first].variable_index] == positions_[static_cast<long>(first)])
+      ++first;
+    if (first == segments_.size())
+      return 0;
+  }
+  initialized_ = true;
+
+  for (std::size_t i = first; i < segments_.size(); ++i)
+  {
+    const Segment& segment = segments_[i];
+    const double position = positions[segment.variable_index];
+    positions_[static_cast<long>(i)] = position;
+
+    if (i == 0)
+      joint_frames_[i] = segment.offset;
+    else
+      joint_frames_[i] = moved_frames_[i - 1] * segment.offset;
+
+    moved_frames_[i] = joint_frames_[i];
+    if (segment.prismatic)
+      moved_frames_[i].translate(position * segment.axis);
+    else
+      moved_frames_[i].rotate(Eigen::AngleAxisd(position, segment.axis));
+  }
+  tip_transform_ = moved_frames_.back() * tip_offset_;
+
+  return segments_.size() - first;
+}
+
+void ChainKinematics::jacobian(Jacobian& jacobian) const
+{
+  jacobian.resize(6, static_cast<long>(segments_.size()));
+  const Eigen::Vector3d& tip_position = tip_transform_.translation();
+  for (std::size_t i = 0; i < segments_.size(); ++i)
+  {
+    // The motion doesn't move the axis, so the frame before it is as good
+    const Eigen::Vector3d axis = joint_frames_[i].linear() * segments_[i].axis;
+    const long column = segments_[i].variable_index;
+    if (segments_[i].prismatic)
+    {
+      jacobian.block<3, 1>(0, column) = axis;
+      jacobian.block<3, 1>(3, column).setZero();
+    }
+    else
+    {
+      jacobian.block<3, 1>(0, column) = axis.cross(tip_position - joint_frames_[i].translation());
+      jacobian.block<3, 1>(3, column) = axis;
+    }
+  }
+}
+
+}  // namespace jog_arm
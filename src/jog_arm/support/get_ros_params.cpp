@@ -71,3 +71,19 @@ bool get_ros_params::getBoolParam(const std::string& name, ros::NodeHandle& n)
     ROS_ERROR_STREAM_NAMED("getBoolParam", "YAML config file does not contain parameter " << name);
   return value;
 }
+
+std::vector<double> get_ros_params::getDoubleArrayParam(const std::string& name, ros::NodeHandle& n)
+{
+  std::vector<double> value;
+  if (!n.getParam(name, value))
+    ROS_ERROR_STREAM_NAMED("getDoubleArrayParam", "YAML config file does not contain parameter " << name);
+  return value;
+}
+
+std::vector<int> get_ros_params::getIntArrayParam(const std::string& name, ros::NodeHandle& n)
+{
+  std::vector<int> value;
+  if (!n.getParam(name, value))
+    ROS_ERROR_STREAM_NAMED("getIntArrayParam", "YAML config file does not contain parameter " << name);
+  return value;
+}
@@ -0,0 +1,42 @@
+#include "jog_arm/support/jacobian_solver.h"
+
+#include <limits>
+
+namespace jog_arm
+{
+JacobianSolver::JacobianSolver(double damping)
+  : damping_(damping), condition_number_(std::numeric_limits<double>::infinity())
+{
+}
+
+void JacobianSolver::compute(const Jacobian& jacobian)
+{
+  svd_.compute(SVDMatrix(jacobian), Eigen::ComputeThinU | Eigen::ComputeThinV);
+
+  // Singular values are sorted in decreasing order
+  const SingularValues& s = svd_.singularValues();
+  const double min_singular_value = s(s.size() - 1);
+
+  if (min_singular_value > 0.)
+    condition_number_ = s(0) / min_singular_value;
+  else
+    condition_number_ = std::numeric_limits<double>::infinity();
+
+  const double damping_sq = damping_ * damping_;
+  inverted_singular_values_.resize(s.size());
+  for (long i = 0; i < s.size(); ++i)
+  {
+    const double denominator = s(i) * s(i) + damping_sq;
+    inverted_singular_values_(i) = (denominator > 0.) ? s(i) / denominator : 0.;
+  }
+
+  pseudo_inverse_.noalias() =
+      svd_.matrixV() * inverted_singular_values_.asDiagonal() * svd_.matrixU().transpose();
+}
+
+void JacobianSolver::solve(const Vector6d& delta_x, JointVector& delta_theta) const
+{
+  delta_theta.noalias() = pseudo_inverse_ * delta_x;
+}
+
+}  // namespace jog_arm
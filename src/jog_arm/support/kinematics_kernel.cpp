@@ -0,0 +1,52 @@
+#include "jog_arm/support/kinematics_kernel.h"
+
+#include <jog_arm/generated_kinematics.h>
+#include <string>
+#include <vector>
+
+namespace jog_arm
+{
+// The kernel has to agree with the chain to this tolerance
+static const double MATCH_TOLERANCE = 1e-9;
+
+static bool matchesChain(const KinematicsKernel& kernel, const robot_model::JointModelGroup* joint_model_group,
+                         ChainKinematics& chain)
+{
+  const std::vector<std::string>& names = joint_model_group->getVariableNames();
+  if (chain.rootLinkName() != kernel.base_link || chain.tipLinkName() != kernel.tip_link ||
+      names.size() != kernel.num_joints)
+    return false;
+  for (std::size_t i = 0; i < names.size(); ++i)
+    if (names[i] != kernel.joint_names[i])
+      return false;
+
+  // Compare at a few configurations that exercise every joint
+  std::vector<double> positions(names.size());
+  Eigen::Matrix4d transform;
+  JacobianSolver::Jacobian expected_jacobian, jacobian(6, static_cast<long>(names.size()));
+  for (int configuration = 0; configuration < 3; ++configuration)
+  {
+    for (std::size_t i = 0; i < positions.size(); ++i)
+      positions[i] = 0.3 * static_cast<double>(configuration) - 0.2 * static_cast<double>(i) + 0.1;
+
+    chain.update(positions.data());
+    chain.jacobian(expected_jacobian);
+    kernel.forward(positions.data(), transform.data());
+    kernel.jacobian(positions.data(), jacobian.data());
+    if (!transform.isApprox(chain.tipTransform().matrix(), MATCH_TOLERANCE) ||
+        !jacobian.isApprox(expected_jacobian, MATCH_TOLERANCE))
+      return false;
+  }
+  return true;
+}
+
+const KinematicsKernel* findKinematicsKernel(const robot_model::JointModelGroup* joint_model_group,
+                                             ChainKinematics& chain)
+{
+  for (const KinematicsKernel* kernel = generated_kinematics::KERNELS; kernel->robot_name; ++kernel)
+    if (matchesChain(*kernel, joint_model_group, chain))
+      return kernel;
+  return nullptr;
+}
+
+}  // namespace jog_arm
@@ -0,0 +1,76 @@
+#include "jog_arm/support/latency_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace jog_arm
+{
+LatencyStats::LatencyStats(double deadline) : max_ns_(0), deadline_misses_(0), deadline_(deadline)
+{
+  for (std::atomic<uint32_t>& bucket : buckets_)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+void LatencyStats::setDeadline(double deadline)
+{
+  deadline_.store(deadline, std::memory_order_relaxed);
+}
+
+void LatencyStats::record(double duration)
+{
+  // 4 buckets per doubling, starting at 1 us
+  const double scaled = duration * 1e6;
+  int bucket = (scaled > 1.) ? static_cast<int>(4. * std::log2(scaled)) : 0;
+  bucket = std::min(bucket, NUM_BUCKETS - 1);
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  const uint64_t duration_ns = static_cast<uint64_t>(std::max(duration, 0.) * 1e9);
+  uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+  while (duration_ns > max_ns && !max_ns_.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed))
+  {
+  }
+
+  const double deadline = deadline_.load(std::memory_order_relaxed);
+  if (deadline > 0. && duration > deadline)
+    deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyStats::Summary LatencyStats::takeSummary()
+{
+  std::array<uint32_t, NUM_BUCKETS> counts;
+  Summary summary;
+  summary.count = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i)
+  {
+    counts[i] = buckets_[i].exchange(0, std::memory_order_relaxed);
+    summary.count += counts[i];
+  }
+  summary.max = 1e-9 * static_cast<double>(max_ns_.exchange(0, std::memory_order_relaxed));
+  summary.deadline_misses = deadline_misses_.exchange(0, std::memory_order_relaxed);
+
+  // The upper bound of the bucket that holds the percentile, but never more
+  // than the exact maximum
+  summary.p50 = 0.;
+  summary.p99 = 0.;
+  const uint64_t p50_rank = (summary.count + 1) / 2;
+  const uint64_t p99_rank = (summary.count * 99 + 99) / 100;
+  uint64_t cumulative = 0;
+  for (int i = 0; i < NUM_BUCKETS && summary.count > 0; ++i)
+  {
+    const uint64_t previous = cumulative;
+    cumulative += counts[i];
+    if (previous < p50_rank && cumulative >= p50_rank)
+      summary.p50 = std::min(bucketLimit(i), summary.max);
+    if (previous < p99_rank && cumulative >= p99_rank)
+      summary.p99 = std::min(bucketLimit(i), summary.max);
+  }
+
+  return summary;
+}
+
+double LatencyStats::bucketLimit(int bucket)
+{
+  return 1e-6 * std::exp2(0.25 * (bucket + 1));
+}
+
+}  // namespace jog_arm
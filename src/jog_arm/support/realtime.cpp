@@ -0,0 +1,51 @@
+#include "jog_arm/support/realtime.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace jog_arm
+{
+int createThread(pthread_t* thread, const ThreadSettings& settings, void* (*routine)(void*), void* arg)
+{
+  pthread_attr_t attr;
+  int error = pthread_attr_init(&attr);
+  if (error)
+    return error;
+
+  if (settings.priority > 0)
+  {
+    // Otherwise the new thread inherits the policy of its creator
+    sched_param param;
+    param.sched_priority = settings.priority;
+    error = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    if (!error)
+      error = pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    if (!error)
+      error = pthread_attr_setschedparam(&attr, &param);
+  }
+
+  if (!error && !settings.cpus.empty())
+  {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : settings.cpus)
+      CPU_SET(cpu, &cpu_set);
+    error = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+  }
+
+  if (!error)
+    error = pthread_create(thread, &attr, routine, arg);
+
+  pthread_attr_destroy(&attr);
+  return error;
+}
+
+int lockMemory()
+{
+  if (mlockall(MCL_CURRENT | MCL_FUTURE))
+    return errno;
+  return 0;
+}
+
+}  // namespace jog_arm
@@ -0,0 +1,133 @@
+// Headless throughput benchmark of the jogging calculations. Needs no ROS
+// master. Usage: jog_arm_bench [samples per robot] [fixture directory]
+
+#include "../fixtures/fixture_model.h"
+#include "../fixtures/fixture_params.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <jog_arm/jog_core.h>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// Count heap allocations in the whole process
+static std::atomic<unsigned long> g_allocations(0);
+
+void* operator new(std::size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+namespace jog_arm_bench
+{
+// Synthetic inputs are drawn once and replayed, so the random number generator
+// is not part of the measurement
+const std::size_t NUM_DISTINCT_SAMPLES = 4096;
+
+void printLatency(const char* name, jog_arm::LatencyStats& stats)
+{
+  const jog_arm::LatencyStats::Summary summary = stats.takeSummary();
+  std::printf("  %-16s p50 %8.2f us   p99 %8.2f us   max %8.2f us\n", name, 1e6 * summary.p50, 1e6 * summary.p99,
+              1e6 * summary.max);
+}
+
+// Run the jogging calculations of one robot on synthetic samples
+int runBenchmark(const std::string& robot, const std::string& fixture_dir, std::size_t num_samples)
+{
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel(robot, fixture_dir);
+  if (!model)
+  {
+    std::fprintf(stderr, "Could not load fixture %s from %s\n", robot.c_str(), fixture_dir.c_str());
+    return 1;
+  }
+
+  const jog_arm::JogCoreParameters params = fixture_model::defaultParameters();
+
+  jog_arm::JogCore core(model, params);
+  jog_arm::JogLatencies latencies;
+  core.setLatencyStats(&latencies);
+
+  // Random joints within the limits and random twists
+  const robot_state::JointModelGroup* group = model->getJointModelGroup(params.move_group_name);
+  const std::size_t num_joints = group->getVariableCount();
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> unit(-1., 1.);
+  std::vector<std::vector<double> > joint_samples(NUM_DISTINCT_SAMPLES, std::vector<double>(num_joints));
+  std::vector<jog_arm::JogCore::Vector6d, Eigen::aligned_allocator<jog_arm::JogCore::Vector6d> > twist_samples(
+      NUM_DISTINCT_SAMPLES);
+  for (std::size_t s = 0; s < NUM_DISTINCT_SAMPLES; ++s)
+  {
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const moveit::core::VariableBounds& bounds = model->getVariableBounds(group->getVariableNames()[j]);
+      joint_samples[s][j] = 0.5 * (bounds.min_position_ + bounds.max_position_) +
+                            0.45 * (bounds.max_position_ - bounds.min_position_) * unit(generator);
+    }
+    for (int k = 0; k < 6; ++k)
+      twist_samples[s](k) = unit(generator);
+  }
+  core.resetPositionFilters(joint_samples[0]);
+
+  // Warm up, then measure
+  for (std::size_t i = 0; i < 1000; ++i)
+    core.jog(twist_samples[i % NUM_DISTINCT_SAMPLES], joint_samples[i % NUM_DISTINCT_SAMPLES], params.pub_period,
+             false);
+
+  // Drop the latencies of the warm-up
+  for (jog_arm::LatencyStats* stats : { &latencies.jacobian, &latencies.pseudo_inverse, &latencies.filtering,
+                                        &latencies.bounds_check, &latencies.total })
+    stats->takeSummary();
+
+  std::size_t num_halted = 0;
+  const unsigned long allocations_before = g_allocations.load();
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < num_samples; ++i)
+  {
+    const std::size_t s = i % NUM_DISTINCT_SAMPLES;
+    jog_arm::Stopwatch watch;
+    const unsigned int status = core.jog(twist_samples[s], joint_samples[s], params.pub_period, false);
+    watch.total(latencies.total);
+    if (status & (jog_arm::JOG_HALT_SINGULARITY | jog_arm::JOG_HALT_BOUNDS))
+      ++num_halted;
+  }
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const unsigned long allocations = g_allocations.load() - allocations_before;
+
+  std::printf("%s: %zu joints, %zu cycles in %.3f s\n", robot.c_str(), num_joints, num_samples, elapsed);
+  std::printf("  %.0f cycles/s, %lu allocations, %zu halted cycles\n", num_samples / elapsed, allocations,
+              num_halted);
+  printLatency("jacobian", latencies.jacobian);
+  printLatency("pseudo-inverse", latencies.pseudo_inverse);
+  printLatency("filtering", latencies.filtering);
+  printLatency("bounds check", latencies.bounds_check);
+  printLatency("total", latencies.total);
+
+  return 0;
+}
+
+}  // namespace jog_arm_bench
+
+int main(int argc, char** argv)
+{
+  const std::size_t num_samples = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::string fixture_dir = (argc > 2) ? argv[2] : JOG_ARM_FIXTURE_DIR;
+
+  int result = 0;
+  result |= jog_arm_bench::runBenchmark("ur5_like", fixture_dir, num_samples);
+  result |= jog_arm_bench::runBenchmark("seven_dof", fixture_dir, num_samples);
+
+  return result;
+}
@@ -0,0 +1,93 @@
+#include "fixtures/fixture_model.h"
+
+#include <gtest/gtest.h>
+#include <jog_arm/support/chain_kinematics.h>
+#include <jog_arm/support/kinematics_kernel.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace chain_kinematics_test
+{
+// Compare with a RobotState at a few joint configurations
+void compareWithRobotState(const std::string& fixture, const std::vector<std::vector<double> >& configurations)
+{
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel(fixture);
+  ASSERT_TRUE(model.get());
+  const robot_state::JointModelGroup* group = model->getJointModelGroup("manipulator");
+  ASSERT_TRUE(group);
+
+  jog_arm::ChainKinematics chain(group);
+  const robot_model::LinkModel* tip = group->getLinkModels().back();
+  EXPECT_EQ(chain.tipLinkName(), tip->getName());
+
+  robot_state::RobotState state(model);
+  state.setToDefaultValues();
+  Eigen::MatrixXd expected_jacobian;
+  jog_arm::ChainKinematics::Jacobian jacobian;
+  for (std::size_t i = 0; i < configurations.size(); ++i)
+  {
+    chain.update(configurations[i].data());
+    state.setJointGroupPositions(group, configurations[i]);
+
+    const Eigen::Matrix4d expected_tip =
+        (state.getGlobalLinkTransform(chain.rootLinkName()).inverse() * state.getGlobalLinkTransform(tip)).matrix();
+    EXPECT_TRUE(chain.tipTransform().matrix().isApprox(expected_tip, 1e-9)) << fixture << " configuration " << i;
+
+    state.getJacobian(group, tip, Eigen::Vector3d::Zero(), expected_jacobian);
+    chain.jacobian(jacobian);
+    EXPECT_TRUE(jacobian.isApprox(expected_jacobian, 1e-9)) << fixture << " configuration " << i;
+  }
+}
+
+TEST(chainKinematicsTest, matchesRobotState)
+{
+  // Successive configurations differ in fewer and fewer leading joints, to
+  // cover the incremental update
+  compareWithRobotState("ur5_like", { { 0., -1.2, 1.4, -1.8, -1.57, 0. },
+                                      { 0., -1.2, 1.4, -1.5, -1.2, 0.3 },
+                                      { 0.4, -1., 1.1, -1.5, -1.2, 0.3 },
+                                      { 0.4, -1., 1.1, -1.5, -1.2, 0.3 } });
+  compareWithRobotState("seven_dof", { { 0.3, 0.7, -0.2, -1.4, 0.4, 0.9, 0.1 },
+                                       { 0.3, 0.7, -0.2, -1.4, 0.4, 0.9, -0.5 },
+                                       { -0.6, 0.2, 0.5, -1., 0.1, 0.3, -0.5 } });
+}
+
+TEST(chainKinematicsTest, incrementalUpdate)
+{
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel("seven_dof");
+  ASSERT_TRUE(model.get());
+  jog_arm::ChainKinematics chain(model->getJointModelGroup("manipulator"));
+
+  std::vector<double> joints = { 0.3, 0.7, -0.2, -1.4, 0.4, 0.9, 0.1 };
+  EXPECT_EQ(chain.update(joints.data()), 7u);
+  EXPECT_EQ(chain.update(joints.data()), 0u);
+  joints[5] = 1.;
+  EXPECT_EQ(chain.update(joints.data()), 2u);
+}
+
+TEST(chainKinematicsTest, generatedKernel)
+{
+  // The fixtures are in the default JOG_ARM_KINEMATICS_CHAINS
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel("ur5_like");
+  ASSERT_TRUE(model.get());
+  const robot_state::JointModelGroup* group = model->getJointModelGroup("manipulator");
+  jog_arm::ChainKinematics chain(group);
+  const jog_arm::KinematicsKernel* kernel = jog_arm::findKinematicsKernel(group, chain);
+  ASSERT_TRUE(kernel);
+  EXPECT_STREQ(kernel->robot_name, "ur5_like");
+
+  const std::vector<double> joints = { 0.4, -1., 1.1, -1.5, -1.2, 0.3 };
+  robot_state::RobotState state(model);
+  state.setToDefaultValues();
+  state.setJointGroupPositions(group, joints);
+  Eigen::MatrixXd expected_jacobian;
+  state.getJacobian(group, group->getLinkModels().back(), Eigen::Vector3d::Zero(), expected_jacobian);
+
+  Eigen::Matrix4d transform;
+  jog_arm::ChainKinematics::Jacobian jacobian(6, 6);
+  kernel->forward(joints.data(), transform.data());
+  kernel->jacobian(joints.data(), jacobian.data());
+  EXPECT_TRUE(transform.isApprox(state.getGlobalLinkTransform("tool0").matrix(), 1e-9));
+  EXPECT_TRUE(jacobian.isApprox(expected_jacobian, 1e-9));
+}
+
+}  // namespace chain_kinematics_test
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <jog_arm/compliant_control/compliant_control.h>
+#include <jog_arm/compliant_control/wrench_transformer.h>
 
 using testing::Types;
 
@@ -174,4 +175,105 @@ TEST(compliantControlTest, getVelocity)
   EXPECT_EQ(vOut[4], 0.0);
   EXPECT_EQ(vOut[5], 0.0);
 }
-}
\ No newline at end of file
+
+TEST(compliantControlTest, fixedSizeAPI)
+{
+  compliant_control::Vector6d stiffness = compliant_control::Vector6d::Constant(1.);
+  compliant_control::Vector6d deadband = compliant_control::Vector6d::Constant(1.);
+  compliant_control::Vector6d end_condition_wrench = compliant_control::Vector6d::Constant(12.0);
+  double filterCutoff = 10.;
+  compliant_control::Vector6d bias = compliant_control::Vector6d::Zero();
+  double highestAllowableForce = 100.;
+  double highestAllowableTorque = 100.;
+  compliant_control::CompliantControl control(stiffness, deadband, end_condition_wrench, filterCutoff, bias,
+                                              highestAllowableForce, highestAllowableTorque);
+
+  // Only torque.z is applied
+  geometry_msgs::WrenchStamped ftData;
+  ftData.wrench.torque.z = 10.0;
+  compliant_control::Vector6d wrench = compliant_control::wrenchToVector(ftData.wrench);
+  EXPECT_EQ(wrench[5], 10.0);
+
+  compliant_control::Vector6d vIn = compliant_control::Vector6d::Zero(), vOut;
+
+  // Spam this several times to allow the filter to settle
+  compliantEnum::exitCondition endcondition = compliantEnum::NOT_CONTROLLED;
+  for (int i = 0; i < 20; i++)
+    endcondition = control.getVelocity(vIn, wrench, vOut);
+
+  EXPECT_TRUE(endcondition == compliantEnum::CONDITION_NOT_MET);
+  EXPECT_NEAR(vOut[3], 0., 1e-6);
+  EXPECT_NEAR(vOut[4], 0., 1e-6);
+  EXPECT_NEAR(vOut[5], 10.0, 0.5);
+}
+
+TEST(compliantControlTest, filterAtSensorRate)
+{
+  compliant_control::Vector6d stiffness = compliant_control::Vector6d::Constant(1.);
+  compliant_control::Vector6d deadband = compliant_control::Vector6d::Zero();
+  compliant_control::Vector6d end_condition_wrench = compliant_control::Vector6d::Constant(12.0);
+  double filterCutoff = 10.;
+  compliant_control::Vector6d bias = compliant_control::Vector6d::Zero();
+  compliant_control::CompliantControl control(stiffness, deadband, end_condition_wrench, filterCutoff, bias, 100.,
+                                              100.);
+
+  // 10 samples per velocity cmd. The batch is filtered sample by sample.
+  compliant_control::Vector6d samples[10];
+  for (int i = 0; i < 10; i++)
+    samples[i] = compliant_control::Vector6d::Constant(5.0);
+
+  compliant_control::Vector6d vIn = compliant_control::Vector6d::Zero(), vOut, vOutRepeated;
+  for (int cmd = 0; cmd < 10; cmd++)
+    control.getFT(samples, 10);
+
+  // No new sample --> the same cmd
+  EXPECT_TRUE(control.getVelocity(vIn, vOut) == compliantEnum::CONDITION_NOT_MET);
+  control.getVelocity(vIn, vOutRepeated);
+  EXPECT_TRUE(vOut == vOutRepeated);
+  EXPECT_NEAR(vOut[0], 5.0, 1e-3);
+}
+
+TEST(compliantControlTest, wrenchAdjoint)
+{
+  // The sensor is 1 m along x, rotated 90 deg about z
+  Eigen::Isometry3d ee_from_sensor = Eigen::Isometry3d::Identity();
+  ee_from_sensor.linear() = Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  ee_from_sensor.translation() = Eigen::Vector3d(1., 0., 0.);
+  compliant_control::Matrix6d adjoint = compliant_control::WrenchTransformer::adjoint(ee_from_sensor);
+
+  // A force along sensor x pushes along EE y, with a lever arm of 1 m about EE z
+  compliant_control::Vector6d sensor_wrench, expected;
+  sensor_wrench << 2., 0., 0., 0., 0., 0.;
+  expected << 0., 2., 0., 0., 0., 2.;
+  EXPECT_TRUE((adjoint * sensor_wrench).isApprox(expected, 1e-12));
+
+  // A pure torque only rotates
+  sensor_wrench << 0., 0., 0., 0., 3., 0.;
+  expected << 0., 0., 0., -3., 0., 0.;
+  EXPECT_TRUE((adjoint * sensor_wrench).isApprox(expected, 1e-12));
+}
+
+TEST(compliantControlTest, wrenchAboutEE)
+{
+  // The sensor is 0.1 m above the EE. The cmd frame is 1 m away and rotated
+  // 90 deg about z.
+  Eigen::Isometry3d ee_from_sensor = Eigen::Isometry3d::Identity();
+  ee_from_sensor.translation() = Eigen::Vector3d(0., 0., 0.1);
+  Eigen::Isometry3d cmd_from_ee = Eigen::Isometry3d::Identity();
+  cmd_from_ee.linear() = Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  cmd_from_ee.translation() = Eigen::Vector3d(1., 0., 0.5);
+  const compliant_control::Matrix6d sensor_to_cmd =
+      compliant_control::WrenchTransformer::rotation(cmd_from_ee) *
+      compliant_control::WrenchTransformer::adjoint(ee_from_sensor);
+
+  // A contact force through the EE point stays torque-free
+  compliant_control::Vector6d sensor_wrench, expected;
+  sensor_wrench << 2., 0., 0., 0., -0.2, 0.;
+  expected << 0., 2., 0., 0., 0., 0.;
+  EXPECT_TRUE((sensor_to_cmd * sensor_wrench).isApprox(expected, 1e-12));
+
+  // About the cmd frame origin, it would have a lever arm
+  const compliant_control::Matrix6d full = compliant_control::WrenchTransformer::adjoint(cmd_from_ee * ee_from_sensor);
+  EXPECT_GT((full * sensor_wrench).tail<3>().norm(), 1.);
+}
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <jog_arm/support/filter_bank.h>
+
+namespace filter_bank_test
+{
+// The per-channel filter the bank replaces
+double referenceFilter(double new_msrmt, double filter_coeff, double prev_msrmts[3], double prev_filtered_msrmts[2])
+{
+  prev_msrmts[2] = prev_msrmts[1];
+  prev_msrmts[1] = prev_msrmts[0];
+  prev_msrmts[0] = new_msrmt;
+
+  double new_filtered_msrmt = (1 / (1 + filter_coeff * filter_coeff + 1.414 * filter_coeff)) *
+                              (prev_msrmts[2] + 2 * prev_msrmts[1] + prev_msrmts[0] -
+                               (filter_coeff * filter_coeff - 1.414 * filter_coeff + 1) * prev_filtered_msrmts[1] -
+                               (-2 * filter_coeff * filter_coeff + 2) * prev_filtered_msrmts[0]);
+
+  prev_filtered_msrmts[1] = prev_filtered_msrmts[0];
+  prev_filtered_msrmts[0] = new_filtered_msrmt;
+  return new_filtered_msrmt;
+}
+
+TEST(filterBankTest, matchesSingleChannelFilter)
+{
+  const int num_channels = 7;
+  const double filter_coeff = 2.;
+  jog_arm::FilterBank bank(num_channels, filter_coeff);
+
+  double prev_msrmts[num_channels][3] = {};
+  double prev_filtered_msrmts[num_channels][2] = {};
+
+  double input[num_channels], output[num_channels];
+  for (int n = 0; n < 100; ++n)
+  {
+    for (int c = 0; c < num_channels; ++c)
+      input[c] = std::sin(0.1 * n * (c + 1)) + c;
+    bank.filter(input, output);
+
+    for (int c = 0; c < num_channels; ++c)
+      EXPECT_NEAR(output[c], referenceFilter(input[c], filter_coeff, prev_msrmts[c], prev_filtered_msrmts[c]), 1e-9);
+  }
+}
+
+TEST(filterBankTest, resetAndInPlace)
+{
+  jog_arm::FilterBank bank(3, 10.);
+
+  // A settled filter passes a constant through
+  const double settled[3] = { 1., -2., 0.5 };
+  bank.reset(settled);
+  double values[3] = { 1., -2., 0.5 };
+  bank.filter(values, values);
+  EXPECT_NEAR(values[0], 1., 1e-12);
+  EXPECT_NEAR(values[1], -2., 1e-12);
+  EXPECT_NEAR(values[2], 0.5, 1e-12);
+
+  // A step is smoothed, then reached
+  bank.reset(0.);
+  double output[3];
+  const double step[3] = { 1., 1., 1. };
+  bank.filter(step, output);
+  EXPECT_GT(output[0], 0.);
+  EXPECT_LT(output[0], 0.1);
+  for (int n = 0; n < 500; ++n)
+    bank.filter(step, output);
+  EXPECT_NEAR(output[2], 1., 1e-6);
+}
+}
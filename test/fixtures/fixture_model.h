@@ -0,0 +1,39 @@
+#ifndef FIXTURE_MODEL_H
+#define FIXTURE_MODEL_H
+
+/**
+ * Load the robot models in test/fixtures straight from file, without a ROS
+ * master or a robot_description param.
+ */
+
+#include <moveit/robot_model/robot_model.h>
+#include <srdfdom/model.h>
+#include <string>
+#include <urdf/model.h>
+
+namespace fixture_model
+{
+// Directory of the fixtures. Set by CMake.
+#ifndef JOG_ARM_FIXTURE_DIR
+#define JOG_ARM_FIXTURE_DIR "test/fixtures"
+#endif
+
+// Load <name>.urdf and <name>.srdf. Returns an empty pointer on failure.
+inline robot_model::RobotModelPtr loadFixtureModel(const std::string& name,
+                                                   const std::string& directory = JOG_ARM_FIXTURE_DIR)
+{
+  urdf::Model* urdf_model = new urdf::Model;
+  urdf::ModelInterfaceSharedPtr urdf_ptr(urdf_model);
+  if (!urdf_model->initFile(directory + "/" + name + ".urdf"))
+    return robot_model::RobotModelPtr();
+
+  srdf::ModelSharedPtr srdf_model(new srdf::Model);
+  if (!srdf_model->initFile(*urdf_model, directory + "/" + name + ".srdf"))
+    return robot_model::RobotModelPtr();
+
+  return robot_model::RobotModelPtr(new robot_model::RobotModel(urdf_ptr, srdf_model));
+}
+
+}  // namespace fixture_model
+
+#endif  // FIXTURE_MODEL_H
@@ -0,0 +1,30 @@
+#ifndef FIXTURE_PARAMS_H
+#define FIXTURE_PARAMS_H
+
+/**
+ * Parameters of the jogging calculations for the fixture models. Shared by the
+ * unit tests and the benchmark.
+ */
+
+#include <jog_arm/jog_core.h>
+
+namespace fixture_model
+{
+// The defaults of jog_settings.yaml
+inline jog_arm::JogCoreParameters defaultParameters()
+{
+  jog_arm::JogCoreParameters params;
+  params.move_group_name = "manipulator";
+  params.linear_scale = 0.0004;
+  params.rot_scale = 0.0008;
+  params.singularity_threshold = 40.;
+  params.hard_stop_sing_thresh = 120.;
+  params.singularity_damping = 0.;
+  params.low_pass_filter_coeff = 2.;
+  params.pub_period = 0.01;
+  return params;
+}
+
+}  // namespace fixture_model
+
+#endif  // FIXTURE_PARAMS_H
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <jog_arm/support/jacobian_solver.h>
+
+namespace jacobian_solver_test
+{
+typedef jog_arm::JacobianSolver::Jacobian Jacobian;
+
+TEST(jacobianSolverTest, squareJacobian)
+{
+  Jacobian jacobian = Eigen::Matrix<double, 6, 6>::Identity();
+  jacobian(0, 0) = 4.;
+  jacobian(5, 5) = 0.5;
+
+  jog_arm::JacobianSolver solver;
+  solver.compute(jacobian);
+
+  EXPECT_NEAR(solver.conditionNumber(), 8., 1e-9);
+  EXPECT_TRUE((solver.pseudoInverse() * jacobian).isIdentity(1e-9));
+}
+
+TEST(jacobianSolverTest, redundantJacobian)
+{
+  Jacobian jacobian(6, 7);
+  jacobian << 0.1, 0.4, 0.3, 0.0, 0.2, 0.1, 0.0,  //
+      0.5, 0.0, 0.1, 0.3, 0.0, 0.1, 0.1,          //
+      0.0, 0.2, 0.4, 0.1, 0.1, 0.0, 0.2,          //
+      0.0, 1.0, 0.0, 0.0, 0.7, 0.0, 0.7,          //
+      0.0, 0.0, 1.0, 0.7, 0.0, 0.7, 0.0,          //
+      1.0, 0.0, 0.0, 0.7, 0.7, 0.0, 0.7;
+
+  jog_arm::JacobianSolver solver;
+  solver.compute(jacobian);
+
+  // A right inverse for a full-rank 6x7 Jacobian
+  EXPECT_EQ(solver.pseudoInverse().rows(), 7);
+  EXPECT_EQ(solver.pseudoInverse().cols(), 6);
+  EXPECT_TRUE((jacobian * solver.pseudoInverse()).isIdentity(1e-9));
+
+  // Same condition number as the square root of the eigenvalue ratio of J*J^T
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 6, 6> > eigs(jacobian * jacobian.transpose());
+  EXPECT_NEAR(solver.conditionNumber(), std::sqrt(eigs.eigenvalues().maxCoeff() / eigs.eigenvalues().minCoeff()),
+              1e-6);
+
+  jog_arm::JacobianSolver::Vector6d delta_x;
+  delta_x << 0.01, -0.02, 0.005, 0.1, 0., -0.05;
+  jog_arm::JacobianSolver::JointVector delta_theta;
+  solver.solve(delta_x, delta_theta);
+  EXPECT_TRUE((jacobian * delta_theta).isApprox(delta_x, 1e-9));
+}
+
+TEST(jacobianSolverTest, singularJacobian)
+{
+  Jacobian jacobian = Eigen::Matrix<double, 6, 6>::Identity();
+  jacobian(5, 5) = 0.;
+
+  // Undamped: infinite condition number, the singular direction is ignored
+  jog_arm::JacobianSolver solver;
+  solver.compute(jacobian);
+  EXPECT_TRUE(std::isinf(solver.conditionNumber()));
+  EXPECT_TRUE(solver.pseudoInverse().allFinite());
+  EXPECT_EQ(solver.pseudoInverse()(5, 5), 0.);
+
+  // Damped: singular values near zero no longer blow up
+  jacobian(5, 5) = 1e-6;
+  solver.setDamping(0.01);
+  solver.compute(jacobian);
+  EXPECT_LT(solver.pseudoInverse()(5, 5), 1.);
+  EXPECT_NEAR(solver.pseudoInverse()(0, 0), 1., 1e-3);
+}
+}
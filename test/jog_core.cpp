@@ -0,0 +1,131 @@
+#include "fixtures/fixture_model.h"
+#include "fixtures/fixture_params.h"
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <jog_arm/jog_core.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace jog_core_test
+{
+TEST(jogCoreTest, linearJog)
+{
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel("ur5_like");
+  ASSERT_TRUE(model.get());
+
+  // Only test the direction of motion here
+  jog_arm::JogCoreParameters params = fixture_model::defaultParameters();
+  jog_arm::JogCore core(model, params);
+  ASSERT_EQ(core.jointNames().size(), 6u);
+
+  std::vector<double> joints = { 0., -1.2, 1.4, -1.8, -1.57, 0. };
+  core.resetPositionFilters(joints);
+
+  robot_state::RobotState state(model);
+  state.setToDefaultValues();
+  const robot_state::JointModelGroup* group = model->getJointModelGroup(params.move_group_name);
+  state.setJointGroupPositions(group, joints);
+  const Eigen::Vector3d start = state.getGlobalLinkTransform("tool0").translation();
+
+  jog_arm::JogCore::Vector6d twist;
+  twist << 1., 0., 0., 0., 0., 0.;
+  for (int i = 0; i < 50; ++i)
+  {
+    const unsigned int status = core.jog(twist, joints, params.pub_period, false);
+    ASSERT_EQ(status, static_cast<unsigned int>(jog_arm::JOG_OK));
+    joints = core.positions();
+  }
+
+  state.setJointGroupPositions(group, joints);
+  const Eigen::Vector3d motion = state.getGlobalLinkTransform("tool0").translation() - start;
+  EXPECT_GT(motion.x(), 0.005);
+  EXPECT_LT(std::abs(motion.y()), 0.1 * motion.x());
+  EXPECT_LT(std::abs(motion.z()), 0.1 * motion.x());
+}
+
+TEST(jogCoreTest, halts)
+{
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel("seven_dof");
+  ASSERT_TRUE(model.get());
+  jog_arm::JogCore core(model, fixture_model::defaultParameters());
+  ASSERT_EQ(core.jointNames().size(), 7u);
+
+  jog_arm::JogCore::Vector6d twist;
+  twist << 0., 0., 1., 0., 0., 0.;
+
+  // Straight up is singular
+  const std::vector<double> straight(7, 0.);
+  core.resetPositionFilters(straight);
+  unsigned int status = core.jog(twist, straight, 0.01, false);
+  EXPECT_TRUE(status & jog_arm::JOG_HALT_SINGULARITY);
+  EXPECT_EQ(core.positions(), straight);
+
+  // Hold the measured joints if a collision is imminent
+  const std::vector<double> bent = { 0.3, 0.7, -0.2, -1.4, 0.4, 0.9, 0.1 };
+  core.resetPositionFilters(bent);
+  status = core.jog(twist, bent, 0.01, true);
+  EXPECT_TRUE(status & jog_arm::JOG_HALT_COLLISION);
+  EXPECT_EQ(core.positions(), bent);
+  EXPECT_EQ(core.velocities(), std::vector<double>(7, 0.));
+
+  EXPECT_EQ(core.jog(twist, std::vector<double>(6, 0.), 0.01, false),
+            static_cast<unsigned int>(jog_arm::JOG_INVALID_INPUT));
+}
+
+TEST(jogCoreTest, singularityThresholds)
+{
+  // With the thresholds of jog_settings.yaml, ordinary poses move freely
+  jog_arm::JogCore::Vector6d twist;
+  twist << 1., 0., 0., 0., 0., 0.;
+  const robot_model::RobotModelPtr seven_dof = fixture_model::loadFixtureModel("seven_dof");
+  ASSERT_TRUE(seven_dof.get());
+  jog_arm::JogCore seven_dof_core(seven_dof, fixture_model::defaultParameters());
+  const std::vector<double> bent = { 0.3, 0.7, -0.2, -1.4, 0.4, 0.9, 0.1 };
+  seven_dof_core.resetPositionFilters(bent);
+  EXPECT_EQ(seven_dof_core.jog(twist, bent, 0.01, false), static_cast<unsigned int>(jog_arm::JOG_OK));
+
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel("ur5_like");
+  ASSERT_TRUE(model.get());
+  jog_arm::JogCore core(model, fixture_model::defaultParameters());
+  std::vector<double> joints = { 0., -1.2, 1.4, -1.8, -1.57, 0. };
+  core.resetPositionFilters(joints);
+  EXPECT_EQ(core.jog(twist, joints, 0.01, false), static_cast<unsigned int>(jog_arm::JOG_OK));
+
+  // Slow down, then stop, as the elbow straightens
+  joints[2] = 0.2;
+  core.resetPositionFilters(joints);
+  EXPECT_EQ(core.jog(twist, joints, 0.01, false), static_cast<unsigned int>(jog_arm::JOG_NEAR_SINGULARITY));
+  joints[2] = 0.05;
+  core.resetPositionFilters(joints);
+  EXPECT_TRUE(core.jog(twist, joints, 0.01, false) & jog_arm::JOG_HALT_SINGULARITY);
+}
+
+TEST(jogCoreTest, extrapolate)
+{
+  const robot_model::RobotModelPtr model = fixture_model::loadFixtureModel("ur5_like");
+  ASSERT_TRUE(model.get());
+  jog_arm::JogCoreParameters params = fixture_model::defaultParameters();
+  jog_arm::JogCore core(model, params);
+
+  std::vector<double> joints = { 0., -1.2, 1.4, -1.8, -1.57, 0. };
+  core.resetPositionFilters(joints);
+  jog_arm::JogCore::Vector6d twist;
+  twist << 1., 0., 0., 0., 0., 0.;
+  ASSERT_EQ(core.jog(twist, joints, params.pub_period, false), static_cast<unsigned int>(jog_arm::JOG_OK));
+
+  // Continue at the commanded velocities
+  std::vector<double> lookahead(joints.size());
+  core.extrapolate(0., lookahead);
+  EXPECT_EQ(lookahead, core.positions());
+  core.extrapolate(2 * params.pub_period, lookahead);
+  for (std::size_t i = 0; i < joints.size(); ++i)
+    EXPECT_NEAR(lookahead[i], core.positions()[i] + 2 * params.pub_period * core.velocities()[i], 1e-12);
+
+  // Never past the position bounds
+  core.extrapolate(1e6, lookahead);
+  robot_state::RobotState state(model);
+  state.setToDefaultValues();
+  state.setJointGroupPositions(model->getJointModelGroup(params.move_group_name), lookahead);
+  EXPECT_TRUE(state.satisfiesBounds(model->getJointModelGroup(params.move_group_name)));
+}
+}
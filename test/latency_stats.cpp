@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <jog_arm/support/latency_stats.h>
+
+namespace latency_stats_test
+{
+TEST(latencyStatsTest, percentiles)
+{
+  jog_arm::LatencyStats stats(0.005);
+
+  // 98 fast cycles, 2 slow ones
+  for (int i = 0; i < 98; ++i)
+    stats.record(100e-6);
+  stats.record(8e-3);
+  stats.record(10e-3);
+
+  jog_arm::LatencyStats::Summary summary = stats.takeSummary();
+  EXPECT_EQ(summary.count, 100u);
+  EXPECT_EQ(summary.deadline_misses, 2u);
+  EXPECT_NEAR(summary.max, 10e-3, 1e-9);
+
+  // Within one bucket width
+  EXPECT_GE(summary.p50, 100e-6);
+  EXPECT_LT(summary.p50, 100e-6 * 1.2);
+  EXPECT_GE(summary.p99, 8e-3);
+  EXPECT_LT(summary.p99, 8e-3 * 1.2);
+}
+
+TEST(latencyStatsTest, summaryResets)
+{
+  jog_arm::LatencyStats stats;
+  stats.record(2.);
+  stats.record(0.);
+
+  jog_arm::LatencyStats::Summary summary = stats.takeSummary();
+  EXPECT_EQ(summary.count, 2u);
+  EXPECT_EQ(summary.deadline_misses, 0u);
+  EXPECT_NEAR(summary.max, 2., 1e-9);
+  EXPECT_LE(summary.p99, summary.max);
+
+  summary = stats.takeSummary();
+  EXPECT_EQ(summary.count, 0u);
+  EXPECT_EQ(summary.max, 0.);
+  EXPECT_EQ(summary.p50, 0.);
+}
+}
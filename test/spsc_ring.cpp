@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <jog_arm/support/spsc_ring.h>
+#include <thread>
+
+namespace spsc_ring_test
+{
+TEST(spscRingTest, fifo)
+{
+  jog_arm::SpscRing<int, 4> ring;
+  int value;
+  EXPECT_FALSE(ring.pop(value));
+
+  // Wrap around the storage a few times
+  for (int round = 0; round < 3; ++round)
+  {
+    for (int i = 0; i < 4; ++i)
+      EXPECT_TRUE(ring.push(10 * round + i));
+    EXPECT_FALSE(ring.push(-1));
+    EXPECT_EQ(ring.size(), 4u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+      ASSERT_TRUE(ring.pop(value));
+      EXPECT_EQ(value, 10 * round + i);
+    }
+    EXPECT_FALSE(ring.pop(value));
+  }
+}
+
+TEST(spscRingTest, twoThreads)
+{
+  const int count = 100000;
+  jog_arm::SpscRing<int, 64> ring;
+
+  std::thread writer([&ring, count]() {
+    for (int i = 0; i < count; ++i)
+      while (!ring.push(i))
+        std::this_thread::yield();
+  });
+
+  // Every value arrives once, in order
+  int expected = 0, value;
+  while (expected < count)
+  {
+    if (ring.pop(value))
+      ASSERT_EQ(value, expected++);
+    else
+      std::this_thread::yield();
+  }
+  writer.join();
+  EXPECT_FALSE(ring.pop(value));
+}
+
+}  // namespace spsc_ring_test